@@ -1,5 +1,6 @@
 #include <refrange/text/bvh.h>
 #include <refrange/binary/vmd.h>
+#include <refrange/mapped_file.h>
 #include <string>
 #include <iostream>
 #include <sstream>
@@ -15,14 +16,14 @@ public:
 
     bool load(const char *path)
     {
-        auto buf=refrange::readfile(path);
-        if(buf.empty()){
+        refrange::mapped_file file(path);
+        if(file.size()==0){
             return false;
 		}
 
 		{
 			refrange::text::bvh::loader l;
-			if (l.load(refrange::vectorrange(buf))){
+			if (l.load(file.range())){
                 m_status << "loaded: " << path << std::endl;
 				return true;
 			}
@@ -30,7 +31,7 @@ public:
 
 		{
 			refrange::binary::vmd::loader l;
-			if (l.load(refrange::vectorrange(buf))){
+			if (l.load(file.range())){
                 m_status << "loaded: " << path << std::endl;
 				return true;
 			}
@@ -0,0 +1,93 @@
+#include <refrange/text/ndjson.h>
+#include <string>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+
+//
+// ndjson_sample [-r] [-j threads] [-s chunk_size] <input> <output>
+//
+// newline delimited json in input is converted to a msgpack stream
+// (one message for each line). -r converts a msgpack stream to ndjson.
+// '-' is stdin or stdout.
+//
+int main(int argc, char **argv)
+{
+    bool reverse=false;
+    size_t threads=0;
+    size_t chunk_size=refrange::text::ndjson::default_chunk_size;
+    int i=1;
+    for(; i<argc; ++i){
+        std::string arg=argv[i];
+        if(arg=="-r"){
+            reverse=true;
+        }
+        else if(arg=="-j" && i+1<argc){
+            threads=strtoul(argv[++i], 0, 10);
+        }
+        else if(arg=="-s" && i+1<argc){
+            chunk_size=strtoul(argv[++i], 0, 10);
+        }
+        else{
+            break;
+        }
+    }
+    if(argc-i<2 || chunk_size==0){
+        std::cerr << "usage: " << argv[0] << " [-r] [-j threads] [-s chunk_size] <input> <output>" << std::endl;
+        return 1;
+    }
+    std::string input=argv[i];
+    std::string output=argv[i+1];
+
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    auto in=input=="-" ? stdin : fopen(input.c_str(), "rb");
+    if(!in){
+        std::cerr << "fail to open: " << input << std::endl;
+        return 1;
+    }
+    auto out=output=="-" ? stdout : fopen(output.c_str(), "wb");
+    if(!out){
+        std::cerr << "fail to open: " << output << std::endl;
+        return 1;
+    }
+
+    refrange::text::json::reader_t reader=[in](unsigned char *p, size_t size)->size_t
+    {
+        return fread(p, 1, size, in);
+    };
+    refrange::text::json::writer_t writer=[out](const unsigned char *p, size_t size)->size_t
+    {
+        return fwrite(p, 1, size, out);
+    };
+
+    int result=0;
+    try {
+        refrange::thread_pool pool(threads);
+        if(reverse){
+            refrange::text::ndjson::to_ndjson(pool, reader, writer, chunk_size);
+        }
+        else{
+            refrange::text::ndjson::to_msgpack(pool, reader, writer, chunk_size);
+        }
+    }
+    catch(const std::exception &e){
+        std::cerr << e.what() << std::endl;
+        result=1;
+    }
+
+    if(in!=stdin){
+        fclose(in);
+    }
+    if(out!=stdout){
+        fclose(out);
+    }
+    return result;
+}
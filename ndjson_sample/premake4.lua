@@ -0,0 +1,19 @@
+project "ndjson_sample"
+--language "C
+language "C++"
+--kind "StaticLib"
+--kind "SharedLib"
+kind "ConsoleApp"
+--kind "WindowApp"
+
+files {
+    "main.cpp",
+}
+includedirs {
+    "../refrange/include",
+}
+defines {
+}
+links {
+}
+
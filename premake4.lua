@@ -56,6 +56,8 @@ end
 configuration {}
 
 include "loader_sample"
+include "query_sample"
+include "ndjson_sample"
 include "asio_sample"
 include "tests"
 include "gtest"
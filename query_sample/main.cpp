@@ -0,0 +1,80 @@
+#include <refrange/msgpack/query.h>
+#include <refrange/mapped_file.h>
+#include <string>
+#include <iostream>
+#include <stdio.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+
+//
+// query_sample [-c] <query> <file>
+//
+// matched values of the packed msgpack stream in file are written to stdout
+// as a msgpack stream. -c prints the number of matches instead.
+//
+int main(int argc, char **argv)
+{
+    bool count_only=false;
+    int i=1;
+    if(i<argc && std::string(argv[i])=="-c"){
+        count_only=true;
+        ++i;
+    }
+    if(argc-i<2){
+        std::cerr << "usage: " << argv[0] << " [-c] <query> <file>" << std::endl;
+        return 1;
+    }
+    auto src=argv[i];
+    auto path=argv[i+1];
+
+    refrange::msgpack::query::matcher matcher;
+    try {
+        matcher=refrange::msgpack::query::compile(src);
+    }
+    catch(const refrange::msgpack::query::query_error &e){
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    refrange::mapped_file file(path, refrange::map_random);
+    if(file.size()==0){
+        std::cerr << "fail to load: " << path << std::endl;
+        return 1;
+    }
+
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    size_t written=0;
+    auto writer=[count_only, &written](const unsigned char *p, size_t size)->size_t
+    {
+        if(!count_only){
+            fwrite(p, 1, size, stdout);
+        }
+        written+=size;
+        return size;
+    };
+    auto pointer=[]()->const unsigned char *{
+        return 0;
+    };
+    auto size=[&written]()->size_t{
+        return written;
+    };
+    refrange::msgpack::packer out(writer, pointer, size);
+
+    try {
+        auto count=matcher.select(file.range(), out);
+        if(count_only){
+            std::cout << count << std::endl;
+        }
+    }
+    catch(const std::exception &e){
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -369,19 +369,24 @@ public:
         r.read_value(index_count);
         m_indices.resize(index_count);
         auto index_size=m_flags[2];
-        auto range=r.read_range(index_count * index_size);
         switch(index_size)
         {
             case 1:
-                std::copy(
-                        (const unsigned char*)range.begin(),
-                        (const unsigned char*)range.end(),
-                        m_indices.begin()
-                        );
+                {
+                    auto range=r.read_range(index_count);
+                    std::copy(range.begin(), range.end(), m_indices.begin());
+                }
                 break;
             case 2:
+                {
+                    auto indices=r.read_array<unsigned short>(index_count);
+                    std::copy(indices.begin(), indices.end(), m_indices.begin());
+                }
                 break;
             case 4:
+                if(index_count){
+                    r.read_array(&m_indices[0], index_count);
+                }
                 break;
 
             default:
@@ -775,89 +780,104 @@ private:
         m_vertices.push_back(vertex());
         auto &v=m_vertices.back();
 
-        r.read_value(v.pos.x);
-        r.read_value(v.pos.y);
-        r.read_value(v.pos.z);
-        r.read_value(v.normal.x);
-        r.read_value(v.normal.y);
-        r.read_value(v.normal.z);
-        r.read_value(v.texcoords.x);
-        r.read_value(v.texcoords.y);
-
         // additional uv
         assert(m_flags[1]==0);
 
+        // pos, normal, uv and the deform type. one bounds check.
         unsigned char deform;
-        r.read_value(deform);
+        {
+            auto head=r.span(33);
+            head.read_value(v.pos);
+            head.read_value(v.normal);
+            head.read_value(v.texcoords);
+            head.read_value(deform);
+        }
+
+        // the deform and the edge. one bounds check.
+        size_t bone_size=m_flags[5];
+        size_t deform_size;
+        switch(deform)
+        {
+            case 0:
+                // BDEF1
+                deform_size=bone_size;
+                break;
+
+            case 1:
+                // BDEF2
+                deform_size=bone_size*2+4;
+                break;
+
+            case 2:
+                // BDEF4
+                deform_size=bone_size*4+16;
+                break;
+
+            case 3:
+                // SDEF: c, r0, r1
+                deform_size=bone_size*2+4+36;
+                break;
+
+            default:
+                assert(false);
+                throw std::invalid_argument(__FUNCTION__);
+        }
+        auto tail=r.span(deform_size+4);
 
         switch(deform)
         {
             case 0:
                 // BDEF1
                 {
-                    unsigned int bone_index=read_bone_index(r);
+                    unsigned int bone_index=read_bone_index(tail);
                 }
                 break;
 
             case 1:
                 // BDEF2
                 {
-                    unsigned int bone_index_0=read_bone_index(r);
-                    unsigned int bone_index_1=read_bone_index(r);
+                    unsigned int bone_index_0=read_bone_index(tail);
+                    unsigned int bone_index_1=read_bone_index(tail);
                     float weight0;
-                    r.read_value(weight0);
+                    tail.read_value(weight0);
                 }
                 break;
 
             case 2:
                 // BDEF4
                 {
-                    unsigned int bone_index_0=read_bone_index(r);
-                    unsigned int bone_index_1=read_bone_index(r);
-                    unsigned int bone_index_2=read_bone_index(r);
-                    unsigned int bone_index_3=read_bone_index(r);
-                    float weight0;
-                    r.read_value(weight0);
-                    float weight1;
-                    r.read_value(weight1);
-                    float weight2;
-                    r.read_value(weight2);
-                    float weight3;
-                    r.read_value(weight3);
+                    unsigned int bone_index_0=read_bone_index(tail);
+                    unsigned int bone_index_1=read_bone_index(tail);
+                    unsigned int bone_index_2=read_bone_index(tail);
+                    unsigned int bone_index_3=read_bone_index(tail);
+                    float weights[4];
+                    tail.read_array(weights, 4);
                 }
                 break;
 
             case 3:
                 // SDEF
                 {
-                    unsigned int bone_index_0=read_bone_index(r);
-                    unsigned int bone_index_1=read_bone_index(r);
+                    unsigned int bone_index_0=read_bone_index(tail);
+                    unsigned int bone_index_1=read_bone_index(tail);
                     float weight0;
-                    r.read_value(weight0);
+                    tail.read_value(weight0);
                     vec3 c;
-                    r.read_value(c.x);
-                    r.read_value(c.y);
-                    r.read_value(c.z);
+                    tail.read_value(c);
                     vec3 r0;
-                    r.read_value(r0.x);
-                    r.read_value(r0.y);
-                    r.read_value(r0.z);
+                    tail.read_value(r0);
                     vec3 r1;
-                    r.read_value(r1.x);
-                    r.read_value(r1.y);
-                    r.read_value(r1.z);
+                    tail.read_value(r1);
                 }
                 break;
-
-            default:
-                assert(false);
-                throw std::invalid_argument(__FUNCTION__);
         }
 
-        r.read_value(v.edge_factor);
+        tail.read_value(v.edge_factor);
     }
 
-    int read_index(range_reader &r, unsigned int byte_size)
+    /// range_reader or unchecked_reader
+    template<typename READER>
+    int read_index(READER &r, unsigned int byte_size)
     {
         switch(byte_size)
         {
@@ -890,12 +910,18 @@ private:
         throw std::invalid_argument(__FUNCTION__);
     } 
 
-    int read_vertex_index(range_reader &r) { return read_index(r, m_flags[2]); }
-    int read_texture_index(range_reader &r) { return read_index(r, m_flags[3]); }
-    int read_material_index(range_reader &r) { return read_index(r, m_flags[4]); }
-    int read_bone_index(range_reader &r) { return read_index(r, m_flags[5]); }
-    int read_morph_index(range_reader &r) { return read_index(r, m_flags[6]); }
-    int read_rigidbody_index(range_reader &r) { return read_index(r, m_flags[7]); }
+    template<typename READER>
+    int read_vertex_index(READER &r) { return read_index(r, m_flags[2]); }
+    template<typename READER>
+    int read_texture_index(READER &r) { return read_index(r, m_flags[3]); }
+    template<typename READER>
+    int read_material_index(READER &r) { return read_index(r, m_flags[4]); }
+    template<typename READER>
+    int read_bone_index(READER &r) { return read_index(r, m_flags[5]); }
+    template<typename READER>
+    int read_morph_index(READER &r) { return read_index(r, m_flags[6]); }
+    template<typename READER>
+    int read_rigidbody_index(READER &r) { return read_index(r, m_flags[7]); }
 
     std::wstring read_text(range_reader &r)
     {
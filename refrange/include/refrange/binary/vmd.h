@@ -92,24 +92,18 @@ public:
             unsigned int motionCount;
             r.read_value(motionCount);
 
+            // name 15, frame 4, pos 12, rot 16, interpolate 64
+            auto records=r.span(motionCount, 111);
             m_boneframes.resize(motionCount);
 			for (unsigned int i = 0; i < motionCount; ++i){
 				auto &f = m_boneframes[i];
 
-				f.bonename = r.read_str(15);
-				r.read_value(f.framenum);
+				f.bonename = records.read_str(15);
+				records.read_value(f.framenum);
                 m_maxframenum=std::max(m_maxframenum, f.framenum);
-				// pos
-				r.read_value(f.pos.x);
-				r.read_value(f.pos.y);
-				r.read_value(f.pos.z);
-				// rot
-				r.read_value(f.rot.x);
-				r.read_value(f.rot.y);
-				r.read_value(f.rot.z);
-				r.read_value(f.rot.w);
-				// interpolate
-				r.read((unsigned char*)f.interpolate, 64);
+				records.read_value(f.pos);
+				records.read_value(f.rot);
+				records.read_array(f.interpolate, 64);
 			}
         }
 
@@ -118,14 +112,16 @@ public:
             unsigned int frameCount;
             r.read_value(frameCount);
 
+            // name 15, frame 4, value 4
+            auto records=r.span(frameCount, 23);
             m_morphframes.resize(frameCount);
 			for (unsigned int i = 0; i < frameCount; ++i){
 				auto &f = m_morphframes[i];
 
-				f.morphname = r.read_str(15);
-				r.read_value(f.framenum);
+				f.morphname = records.read_str(15);
+				records.read_value(f.framenum);
                 m_maxframenum=std::max(m_maxframenum, f.framenum);
-				r.read_value(f.value);
+				records.read_value(f.value);
 			}
 		}
 
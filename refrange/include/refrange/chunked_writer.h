@@ -0,0 +1,245 @@
+#pragma once
+#include "range.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <string.h>
+
+
+namespace refrange {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// growable writer for output of unknown size
+//////////////////////////////////////////////////////////////////////////////
+// a chain of fixed size blocks. a write never moves the data written before.
+// hand the blocks to writev/WSASend as a gather list or flatten them on demand.
+enum { default_block_size=64*1024 };
+
+
+struct write_block
+{
+    std::unique_ptr<unsigned char[]> data;
+    size_t capacity;
+    size_t size;
+
+    write_block()
+        : capacity(0), size(0)
+    {}
+
+    explicit write_block(size_t _capacity)
+        : data(new unsigned char[_capacity]), capacity(_capacity), size(0)
+    {}
+
+    write_block(write_block &&rhs)
+        : data(std::move(rhs.data)), capacity(rhs.capacity), size(rhs.size)
+    {}
+
+    write_block &operator=(write_block &&rhs)
+    {
+        data=std::move(rhs.data);
+        capacity=rhs.capacity;
+        size=rhs.size;
+        return *this;
+    }
+
+    size_t remain()const{ return capacity-size; }
+};
+
+
+/// keeps released blocks for the next writer. thread safe.
+class block_pool
+{
+    size_t m_block_size;
+    size_t m_max_free;
+    std::vector<write_block> m_free;
+    std::mutex m_mutex;
+
+    block_pool(const block_pool &);
+    block_pool &operator=(const block_pool &);
+
+public:
+    block_pool(size_t block_size=default_block_size, size_t max_free=64)
+        : m_block_size(block_size), m_max_free(max_free)
+    {
+        if(block_size==0){
+            throw std::invalid_argument(__FUNCTION__);
+        }
+    }
+
+    size_t block_size()const{ return m_block_size; }
+
+    size_t free_count()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_free.size();
+    }
+
+    write_block acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_free.empty()){
+                auto b=std::move(m_free.back());
+                m_free.pop_back();
+                b.size=0;
+                return b;
+            }
+        }
+        return write_block(m_block_size);
+    }
+
+    void release(write_block &&b)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(b.capacity==m_block_size && m_free.size()<m_max_free){
+            m_free.push_back(std::move(b));
+        }
+    }
+};
+
+
+class chunked_writer
+{
+    std::vector<write_block> m_blocks;
+    block_pool *m_pool;
+    size_t m_block_size;
+    size_t m_size;
+    // flatten cache
+    std::vector<unsigned char> m_flat;
+
+    chunked_writer(const chunked_writer &);
+    chunked_writer &operator=(const chunked_writer &);
+
+public:
+    /// block_size>0
+    chunked_writer(size_t block_size=default_block_size)
+        : m_pool(0), m_block_size(block_size), m_size(0)
+    {
+        if(block_size==0){
+            throw std::invalid_argument(__FUNCTION__);
+        }
+    }
+
+    /// the blocks come from and go back to pool. pool has to outlive the writer.
+    chunked_writer(block_pool &pool)
+        : m_pool(&pool), m_block_size(pool.block_size()), m_size(0)
+    {
+        if(m_block_size==0){
+            throw std::invalid_argument(__FUNCTION__);
+        }
+    }
+
+    chunked_writer(chunked_writer &&rhs)
+        : m_blocks(std::move(rhs.m_blocks)), m_pool(rhs.m_pool), m_block_size(rhs.m_block_size)
+          , m_size(rhs.m_size), m_flat(std::move(rhs.m_flat))
+    {
+        rhs.m_blocks.clear();
+        rhs.m_size=0;
+    }
+
+    ~chunked_writer()
+    {
+        clear();
+    }
+
+    size_t size()const{ return m_size; }
+    size_t block_count()const{ return m_blocks.size(); }
+
+    /// the blocks go back to the pool
+    void clear()
+    {
+        if(m_pool){
+            for(auto it=m_blocks.begin(); it!=m_blocks.end(); ++it){
+                m_pool->release(std::move(*it));
+            }
+        }
+        m_blocks.clear();
+        m_size=0;
+        m_flat.clear();
+    }
+
+    size_t write(const unsigned char *p, size_t len)
+    {
+        if(!p){
+            return 0;
+        }
+        m_flat.clear();
+        auto rest=len;
+        while(rest){
+            if(m_blocks.empty() || m_blocks.back().remain()==0){
+                m_blocks.push_back(m_pool ? m_pool->acquire() : write_block(m_block_size));
+            }
+            auto &b=m_blocks.back();
+            auto n=std::min(rest, b.remain());
+            memcpy(b.data.get()+b.size, p, n);
+            b.size+=n;
+            p+=n;
+            rest-=n;
+        }
+        m_size+=len;
+        return len;
+    }
+
+    template<typename T>
+        size_t write_value(const T &t)
+        {
+            return write((const unsigned char*)&t, sizeof(T));
+        }
+
+    /// one range per block for vectored I/O
+    std::vector<immutable_range> gather()const
+    {
+        std::vector<immutable_range> list;
+        list.reserve(m_blocks.size());
+        for(auto it=m_blocks.begin(); it!=m_blocks.end(); ++it){
+            list.push_back(immutable_range(it->data.get(), it->data.get()+it->size));
+        }
+        return list;
+    }
+
+    /// writer(p, size)->size_t for each block. stops at a short write.
+    template<typename F>
+        size_t write_to(F writer)const
+        {
+            size_t written=0;
+            for(auto it=m_blocks.begin(); it!=m_blocks.end(); ++it){
+                auto n=writer(it->data.get(), it->size);
+                written+=n;
+                if(n!=it->size){
+                    break;
+                }
+            }
+            return written;
+        }
+
+    /// dst needs size() bytes
+    void copy_to(unsigned char *dst)const
+    {
+        for(auto it=m_blocks.begin(); it!=m_blocks.end(); ++it){
+            memcpy(dst, it->data.get(), it->size);
+            dst+=it->size;
+        }
+    }
+
+    /// a contiguous copy. valid until the next write.
+    /// a single block is returned without the copy.
+    immutable_range flatten()
+    {
+        if(m_blocks.empty()){
+            return immutable_range();
+        }
+        if(m_blocks.size()==1){
+            auto p=m_blocks[0].data.get();
+            return immutable_range(p, p+m_size);
+        }
+        if(m_flat.size()!=m_size){
+            m_flat.resize(m_size);
+            copy_to(&m_flat[0]);
+        }
+        return vectorrange(m_flat);
+    }
+};
+
+
+} // namespace
@@ -0,0 +1,210 @@
+#pragma once
+#include "range.h"
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace refrange {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// read only memory mapped file
+//////////////////////////////////////////////////////////////////////////////
+// the loaders parse straight from the page cache without the copy of readfile.
+// the ranges taken from it are valid until it is closed or destroyed.
+enum map_hint_t
+{
+    // front to back once. read ahead and drop behind (bvh, vmd, pmx...)
+    map_sequential,
+    // jumps around. no read ahead (msgpack query)
+    map_random,
+};
+
+
+class mapped_file
+{
+    const unsigned char *m_begin;
+    size_t m_size;
+    bool m_open;
+#ifdef _WIN32
+    HANDLE m_mapping;
+#endif
+
+    mapped_file(const mapped_file &);
+    mapped_file &operator=(const mapped_file &);
+
+public:
+    mapped_file()
+        : m_begin(0), m_size(0), m_open(false)
+#ifdef _WIN32
+        , m_mapping(0)
+#endif
+    {}
+
+    /// check is_open
+    explicit mapped_file(const char *path, map_hint_t hint=map_sequential)
+        : m_begin(0), m_size(0), m_open(false)
+#ifdef _WIN32
+        , m_mapping(0)
+#endif
+    {
+        open(path, hint);
+    }
+
+    mapped_file(mapped_file &&rhs)
+        : m_begin(0), m_size(0), m_open(false)
+#ifdef _WIN32
+        , m_mapping(0)
+#endif
+    {
+        swap(rhs);
+    }
+
+    mapped_file &operator=(mapped_file &&rhs)
+    {
+        if(this!=&rhs){
+            close();
+            swap(rhs);
+        }
+        return *this;
+    }
+
+    ~mapped_file()
+    {
+        close();
+    }
+
+    void swap(mapped_file &rhs)
+    {
+        std::swap(m_begin, rhs.m_begin);
+        std::swap(m_size, rhs.m_size);
+        std::swap(m_open, rhs.m_open);
+#ifdef _WIN32
+        std::swap(m_mapping, rhs.m_mapping);
+#endif
+    }
+
+    /// an empty file is open with an empty range
+    bool is_open()const{ return m_open; }
+    size_t size()const{ return m_size; }
+    const unsigned char *begin()const{ return m_begin; }
+    const unsigned char *end()const{ return m_begin+m_size; }
+    immutable_range range()const{ return immutable_range(m_begin, m_begin+m_size); }
+
+#ifdef _WIN32
+    bool open(const char *path, map_hint_t hint=map_sequential)
+    {
+        close();
+        auto file=CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING,
+                hint==map_sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, 0);
+        if(file==INVALID_HANDLE_VALUE){
+            return false;
+        }
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(file, &size)){
+            CloseHandle(file);
+            return false;
+        }
+        if(size.QuadPart==0){
+            // a mapping of 0 bytes fails
+            CloseHandle(file);
+            m_open=true;
+            return true;
+        }
+        // the view keeps the mapping and the mapping keeps the file
+        m_mapping=CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+        CloseHandle(file);
+        if(!m_mapping){
+            return false;
+        }
+        auto view=MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        if(!view){
+            CloseHandle(m_mapping);
+            m_mapping=0;
+            return false;
+        }
+        m_begin=static_cast<const unsigned char*>(view);
+        m_size=static_cast<size_t>(size.QuadPart);
+        m_open=true;
+        return true;
+    }
+
+    void close()
+    {
+        if(m_begin){
+            UnmapViewOfFile(m_begin);
+        }
+        if(m_mapping){
+            CloseHandle(m_mapping);
+        }
+        m_begin=0;
+        m_size=0;
+        m_open=false;
+        m_mapping=0;
+    }
+#else
+    bool open(const char *path, map_hint_t hint=map_sequential)
+    {
+        close();
+        int fd=::open(path, O_RDONLY);
+        if(fd<0){
+            return false;
+        }
+        struct stat st;
+        if(fstat(fd, &st)!=0 || !S_ISREG(st.st_mode)){
+            ::close(fd);
+            return false;
+        }
+        if(st.st_size==0){
+            // a mapping of 0 bytes fails
+            ::close(fd);
+            m_open=true;
+            return true;
+        }
+        auto size=static_cast<size_t>(st.st_size);
+        // the mapping keeps the file
+        auto p=mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(p==MAP_FAILED){
+            return false;
+        }
+        // hints only. failures do not matter.
+        if(hint==map_sequential){
+            madvise(p, size, MADV_SEQUENTIAL);
+            madvise(p, size, MADV_WILLNEED);
+        }
+        else{
+            madvise(p, size, MADV_RANDOM);
+        }
+        m_begin=static_cast<const unsigned char*>(p);
+        m_size=size;
+        m_open=true;
+        return true;
+    }
+
+    void close()
+    {
+        if(m_begin){
+            munmap(const_cast<unsigned char*>(m_begin), m_size);
+        }
+        m_begin=0;
+        m_size=0;
+        m_open=false;
+    }
+#endif
+};
+
+
+} // namespace
@@ -659,41 +659,77 @@ struct map32_tag: public no_value_base_tag
     }
 };
 
-#if 0
+/// ext types carry a signed type byte before the data.
+/// len() is the size of the data without the type byte.
+struct ext_base_tag: public read_sequence_value_base_tag
+{
+    ext_base_tag(const unsigned char *begin)
+        : read_sequence_value_base_tag(begin)
+    {}
+};
+
 /// fixext 1 stores an integer and a byte array whose length is 1 byte
 /// +--------+--------+--------+
 /// |  0xd4  |  type  |  data  |
 /// +--------+--------+--------+
-struct fixext1_tag
+struct fixext1_tag: public ext_base_tag
 {
     enum bits_t { bits=0xd4 };
+
+    fixext1_tag(const unsigned char *begin)
+        : ext_base_tag(begin)
+    {}
+
+    unsigned char len()const{ return 1; }
+    signed char type()const{ return static_cast<signed char>(*(begin+1)); }
 };
 
 /// fixext 2 stores an integer and a byte array whose length is 2 bytes
 /// +--------+--------+--------+--------+
 /// |  0xd5  |  type  |       data      |
 /// +--------+--------+--------+--------+
-struct fixext2_tag
+struct fixext2_tag: public ext_base_tag
 {
     enum bits_t { bits=0xd5 };
+
+    fixext2_tag(const unsigned char *begin)
+        : ext_base_tag(begin)
+    {}
+
+    unsigned char len()const{ return 2; }
+    signed char type()const{ return static_cast<signed char>(*(begin+1)); }
 };
 
 /// fixext 4 stores an integer and a byte array whose length is 4 bytes
 /// +--------+--------+--------+--------+--------+--------+
 /// |  0xd6  |  type  |                data               |
 /// +--------+--------+--------+--------+--------+--------+
-struct fixext4_tag
+struct fixext4_tag: public ext_base_tag
 {
     enum bits_t { bits=0xd6 };
+
+    fixext4_tag(const unsigned char *begin)
+        : ext_base_tag(begin)
+    {}
+
+    unsigned char len()const{ return 4; }
+    signed char type()const{ return static_cast<signed char>(*(begin+1)); }
 };
 
 /// fixext 8 stores an integer and a byte array whose length is 8 bytes
 /// +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
 /// |  0xd7  |  type  |                                  data                                 |
 /// +--------+--------+--------+--------+--------+--------+--------+--------+--------+--------+
-struct fixext8_tag
+struct fixext8_tag: public ext_base_tag
 {
     enum bits_t { bits=0xd7 };
+
+    fixext8_tag(const unsigned char *begin)
+        : ext_base_tag(begin)
+    {}
+
+    unsigned char len()const{ return 8; }
+    signed char type()const{ return static_cast<signed char>(*(begin+1)); }
 };
 
 /// fixext 16 stores an integer and a byte array whose length is 16 bytes
@@ -703,38 +739,74 @@ struct fixext8_tag
 /// +--------+--------+--------+--------+--------+--------+--------+--------+
 ///                               data (cont.)                              |
 /// +--------+--------+--------+--------+--------+--------+--------+--------+
-struct fixext16_tag
+struct fixext16_tag: public ext_base_tag
 {
     enum bits_t { bits=0xd8 };
+
+    fixext16_tag(const unsigned char *begin)
+        : ext_base_tag(begin)
+    {}
+
+    unsigned char len()const{ return 16; }
+    signed char type()const{ return static_cast<signed char>(*(begin+1)); }
 };
 
 /// ext 8 stores an integer and a byte array whose length is upto (2^8)-1 bytes:
 /// +--------+--------+--------+========+
 /// |  0xc7  |XXXXXXXX|  type  |  data  |
 /// +--------+--------+--------+========+
-struct ext8_tag
+struct ext8_tag: public ext_base_tag
 {
     enum bits_t { bits=0xc7 };
+
+    ext8_tag(const unsigned char *begin)
+        : ext_base_tag(begin)
+    {}
+
+    unsigned char len()const
+    {
+        return *(begin+1);
+    }
+    signed char type()const{ return static_cast<signed char>(*(begin+2)); }
 };
 
 /// ext 16 stores an integer and a byte array whose length is upto (2^16)-1 bytes:
 /// +--------+--------+--------+--------+========+
 /// |  0xc8  |YYYYYYYY|YYYYYYYY|  type  |  data  |
 /// +--------+--------+--------+--------+========+
-struct ext16_tag
+struct ext16_tag: public ext_base_tag
 {
     enum bits_t { bits=0xc8 };
+
+    ext16_tag(const unsigned char *begin)
+        : ext_base_tag(begin)
+    {}
+
+    unsigned short len()const
+    {
+        return *((unsigned short*)(begin+1));
+    }
+    signed char type()const{ return static_cast<signed char>(*(begin+3)); }
 };
 
 /// ext 32 stores an integer and a byte array whose length is upto (2^32)-1 bytes:
 /// +--------+--------+--------+--------+--------+--------+========+
 /// |  0xc9  |ZZZZZZZZ|ZZZZZZZZ|ZZZZZZZZ|ZZZZZZZZ|  type  |  data  |
 /// +--------+--------+--------+--------+--------+--------+========+
-struct ext32_tag
+struct ext32_tag: public ext_base_tag
 {
     enum bits_t { bits=0xc9 };
+
+    ext32_tag(const unsigned char *begin)
+        : ext_base_tag(begin)
+    {}
+
+    unsigned int len()const
+    {
+        return *((unsigned int*)(begin+1));
+    }
+    signed char type()const{ return static_cast<signed char>(*(begin+5)); }
 };
-#endif
 
 
 
@@ -1055,6 +1127,70 @@ struct sequence_buffer: public base_buffer
 };
 
 
+// str/bin payload as a view into the packed buffer (no copy)
+struct view_buffer: public base_buffer
+{
+    immutable_range &m_v;
+
+    view_buffer(immutable_range &v)
+        : m_v(v)
+    {
+    }
+
+    template<class Tag>
+        void read_from(Tag &tag, range_reader &reader)
+        {
+            _read_from(tag, reader, typename Tag::read_category(), typename Tag::value_category());
+        }
+
+private:
+    template<class Tag, class ReadCategory, class ValueCategory>
+        void _read_from(Tag &tag, range_reader &reader, ReadCategory, ValueCategory)
+        {
+            throw incompatible_unpack_type(__FUNCTION__);
+        }
+
+    template<class Tag>
+        void _read_from(Tag &tag, range_reader &reader, read_value_tag, sequence_value_tag)
+        {
+            m_v=reader.read_range(tag.len());
+        }
+};
+
+
+// ext type and payload as a view into the packed buffer (no copy)
+struct ext_view_buffer: public base_buffer
+{
+    signed char &m_type;
+    immutable_range &m_v;
+
+    ext_view_buffer(signed char &type, immutable_range &v)
+        : m_type(type), m_v(v)
+    {
+    }
+
+    template<class Tag>
+        void read_from(Tag &tag, range_reader &reader)
+        {
+            _read_from(tag, reader, typename std::is_base_of<ext_base_tag, Tag>::type());
+        }
+
+private:
+    template<class Tag>
+        void _read_from(Tag &tag, range_reader &reader, std::false_type)
+        {
+            throw incompatible_unpack_type(__FUNCTION__);
+        }
+
+    template<class Tag>
+        void _read_from(Tag &tag, range_reader &reader, std::true_type)
+        {
+            m_type=tag.type();
+            m_v=reader.read_range(tag.len());
+        }
+};
+
+
 //////////////////////////////////////////////////////////////////////////////
 // packer
 //////////////////////////////////////////////////////////////////////////////
@@ -1128,19 +1264,19 @@ public:
                     write_value(static_cast<char>(v));
                     return *this;
                 }
-                if(n>-0xff){
+                if(n>=-0x80){
                     // int8
                     write_head_byte<int8_tag>();
                     write_value(static_cast<char>(n));
                     return *this;
                 }
-                if(n>-0xffff){
+                if(n>=-0x8000){
                     // int16
                     write_head_byte<int16_tag>();
                     write_value(static_cast<short>(n));
                     return *this;
                 }
-                if(n>-((long long)0xffffffff)){
+                if(n>=-0x80000000LL){
                     // int32
                     write_head_byte<int32_tag>();
                     write_value(static_cast<int>(n));
@@ -1272,6 +1408,42 @@ public:
         return *this;
     }
 
+    packer& pack_ext(signed char type, const unsigned char *p, size_t len)
+    {
+        switch(len)
+        {
+            case 1: write_head_byte<fixext1_tag>(); break;
+            case 2: write_head_byte<fixext2_tag>(); break;
+            case 4: write_head_byte<fixext4_tag>(); break;
+            case 8: write_head_byte<fixext8_tag>(); break;
+            case 16: write_head_byte<fixext16_tag>(); break;
+            default:
+                if(len<=0xff){
+                    // ext8
+                    write_head_byte<ext8_tag>();
+                    write_value(static_cast<unsigned char>(len));
+                }
+                else if(len<=0xffff){
+                    // ext16
+                    write_head_byte<ext16_tag>();
+                    write_value(static_cast<unsigned short>(len));
+                }
+                else if(len<=0xffffffff){
+                    // ext32
+                    write_head_byte<ext32_tag>();
+                    write_value(static_cast<unsigned int>(len));
+                }
+                else{
+                    throw std::out_of_range(__FUNCTION__);
+                }
+                break;
+        }
+        write_value(type);
+        size_t size=write(p, len);
+        assert(size==len);
+        return *this;
+    }
+
     packer &begin_collection(const collection_context &c)
     {
         assert(c.type!=collection_context::collection_unknown);
@@ -1383,6 +1555,171 @@ inline collection_context map(const packer &packer)
             packer.items(), packer.pointer(), packer.size());
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// scan
+//////////////////////////////////////////////////////////////////////////////
+/// sizes read from the head of a packed value
+struct value_head
+{
+    // head byte and length field
+    size_t header;
+    // bytes that follow the header (str/bin data or scalar value)
+    size_t payload;
+    // values that follow for a collection (a map counts keys and values)
+    size_t children;
+
+    value_head()
+        : header(1), payload(0), children(0)
+    {}
+};
+
+inline value_head scan_head(const unsigned char *p, const unsigned char *end)
+{
+    if(p>=end){
+        throw std::range_error(__FUNCTION__);
+    }
+    value_head head;
+    switch(*p)
+    {
+        case nil_tag::bits:
+        case false_tag::bits:
+        case true_tag::bits:
+            break;
+
+        case uint8_tag::bits:
+        case int8_tag::bits:
+            head.payload=1;
+            break;
+
+        case uint16_tag::bits:
+        case int16_tag::bits:
+            head.payload=2;
+            break;
+
+        case uint32_tag::bits:
+        case int32_tag::bits:
+        case float32_tag::bits:
+            head.payload=4;
+            break;
+
+        case uint64_tag::bits:
+        case int64_tag::bits:
+        case float64_tag::bits:
+            head.payload=8;
+            break;
+
+        case str8_tag::bits:
+        case bin8_tag::bits:
+            head.header=2;
+            if(end-p<2){ throw std::range_error(__FUNCTION__); }
+            head.payload=str8_tag(p).len();
+            break;
+
+        case str16_tag::bits:
+        case bin16_tag::bits:
+            head.header=3;
+            if(end-p<3){ throw std::range_error(__FUNCTION__); }
+            head.payload=str16_tag(p).len();
+            break;
+
+        case str32_tag::bits:
+        case bin32_tag::bits:
+            head.header=5;
+            if(end-p<5){ throw std::range_error(__FUNCTION__); }
+            head.payload=str32_tag(p).len();
+            break;
+
+        case array16_tag::bits:
+            head.header=3;
+            if(end-p<3){ throw std::range_error(__FUNCTION__); }
+            head.children=array16_tag(p).len();
+            break;
+
+        case array32_tag::bits:
+            head.header=5;
+            if(end-p<5){ throw std::range_error(__FUNCTION__); }
+            head.children=array32_tag(p).len();
+            break;
+
+        case map16_tag::bits:
+            head.header=3;
+            if(end-p<3){ throw std::range_error(__FUNCTION__); }
+            head.children=static_cast<size_t>(map16_tag(p).len())*2;
+            break;
+
+        case map32_tag::bits:
+            head.header=5;
+            if(end-p<5){ throw std::range_error(__FUNCTION__); }
+            head.children=static_cast<size_t>(map32_tag(p).len())*2;
+            break;
+
+        case fixext1_tag::bits:
+        case fixext2_tag::bits:
+        case fixext4_tag::bits:
+        case fixext8_tag::bits:
+        case fixext16_tag::bits:
+            head.header=2;
+            head.payload=static_cast<size_t>(1)<<(*p-fixext1_tag::bits);
+            break;
+
+        case ext8_tag::bits:
+            head.header=3;
+            if(end-p<3){ throw std::range_error(__FUNCTION__); }
+            head.payload=ext8_tag(p).len();
+            break;
+
+        case ext16_tag::bits:
+            head.header=4;
+            if(end-p<4){ throw std::range_error(__FUNCTION__); }
+            head.payload=ext16_tag(p).len();
+            break;
+
+        case ext32_tag::bits:
+            head.header=6;
+            if(end-p<6){ throw std::range_error(__FUNCTION__); }
+            head.payload=ext32_tag(p).len();
+            break;
+
+        default:
+            if(positive_fixint_tag::is_match(*p)
+                    || negative_fixint_tag::is_match(*p)){
+                // header only
+            }
+            else if(fixstr_tag::is_match(*p)){
+                head.payload=fixstr_tag::extract_head_byte(*p);
+            }
+            else if(fixarray_tag::is_match(*p)){
+                head.children=fixarray_tag::extract_head_byte(*p);
+            }
+            else if(fixmap_tag::is_match(*p)){
+                head.children=fixmap_tag::extract_head_byte(*p)*2;
+            }
+            else{
+                throw invalid_head_byte(__FUNCTION__);
+            }
+            break;
+    }
+    if(static_cast<size_t>(end-p)<head.header+head.payload){
+        throw std::range_error(__FUNCTION__);
+    }
+    return head;
+}
+
+/// returns the end of the value that starts at p without decoding it.
+/// nested collections are counted instead of recursed.
+inline const unsigned char *skip_value(const unsigned char *p, const unsigned char *end)
+{
+    size_t pending=1;
+    while(pending){
+        auto head=scan_head(p, end);
+        p+=head.header+head.payload;
+        pending+=head.children;
+        --pending;
+    }
+    return p;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 // unpacker
 //////////////////////////////////////////////////////////////////////////////
@@ -1424,6 +1761,16 @@ inline sequence_buffer<std::vector<unsigned char>> create_buffer(std::vector<uns
     return sequence_buffer<std::vector<unsigned char>>(t);
 }
 
+inline view_buffer create_view_buffer(immutable_range &t)
+{
+    return view_buffer(t);
+}
+
+inline ext_view_buffer create_ext_view_buffer(signed char &type, immutable_range &t)
+{
+    return ext_view_buffer(type, t);
+}
+
 inline base_buffer dummy_buffer()
 {
     return base_buffer();
@@ -1447,6 +1794,14 @@ public:
         return unpack(base_buffer());
     }
 
+    // drop a whole value including the children of a collection
+    unpacker& skip()
+    {
+        auto p=m_range.get_current();
+        m_range.skip(skip_value(p, m_range.get_range().end())-p);
+        return *this;
+    }
+
     template<class BUFFER>
         unpacker& unpack(BUFFER &b)
         {
@@ -1557,18 +1912,46 @@ public:
                     b.read_from(map32_tag(p_head_byte), m_range);
                     break;
 
-#if 0
-                case ext8_tag::bits:
-                case ext16_tag::bits:
-                case ext32_tag::bits:
+                    // ext
                 case fixext1_tag::bits:
+                    m_range.skip(1);
+                    b.read_from(fixext1_tag(p_head_byte), m_range);
+                    break;
+
                 case fixext2_tag::bits:
+                    m_range.skip(1);
+                    b.read_from(fixext2_tag(p_head_byte), m_range);
+                    break;
+
                 case fixext4_tag::bits:
+                    m_range.skip(1);
+                    b.read_from(fixext4_tag(p_head_byte), m_range);
+                    break;
+
                 case fixext8_tag::bits:
+                    m_range.skip(1);
+                    b.read_from(fixext8_tag(p_head_byte), m_range);
+                    break;
+
                 case fixext16_tag::bits:
-                    // not implmented
-                    throw std::exception(__FUNCTION__);
-#endif
+                    m_range.skip(1);
+                    b.read_from(fixext16_tag(p_head_byte), m_range);
+                    break;
+
+                case ext8_tag::bits:
+                    m_range.skip(2);
+                    b.read_from(ext8_tag(p_head_byte), m_range);
+                    break;
+
+                case ext16_tag::bits:
+                    m_range.skip(3);
+                    b.read_from(ext16_tag(p_head_byte), m_range);
+                    break;
+
+                case ext32_tag::bits:
+                    m_range.skip(5);
+                    b.read_from(ext32_tag(p_head_byte), m_range);
+                    break;
 
                 default:
                     if(positive_fixint_tag::is_match(*p_head_byte)){
@@ -1684,6 +2067,24 @@ public:
         return fixstr_tag::is_match(head_byte);
     }
 
+    bool is_ext()
+    {
+        auto head_byte=m_range.peek_byte();
+        switch(head_byte)
+        {
+            case fixext1_tag::bits:
+            case fixext2_tag::bits:
+            case fixext4_tag::bits:
+            case fixext8_tag::bits:
+            case fixext16_tag::bits:
+            case ext8_tag::bits:
+            case ext16_tag::bits:
+            case ext32_tag::bits:
+                return true;
+        }
+        return false;
+    }
+
     bool is_sequence()
     {
         return is_bin() || is_str();
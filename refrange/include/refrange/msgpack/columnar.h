@@ -0,0 +1,277 @@
+#pragma once
+#include "../msgpack.h"
+#include "basic_overload.h"
+#include <string>
+#include <vector>
+
+namespace refrange {
+namespace msgpack {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// columnar (struct of arrays)
+//////////////////////////////////////////////////////////////////////////////
+enum column_type_t
+{
+    column_int,
+    column_float,
+    column_bool,
+    column_string,
+};
+
+
+struct column
+{
+    std::string name;
+    column_type_t type;
+
+    // one of them is used by type
+    std::vector<long long> ints;
+    std::vector<double> floats;
+    std::vector<unsigned char> bools;
+
+    // string i is blob[offsets[i], offsets[i+1])
+    std::vector<size_t> offsets;
+    std::vector<unsigned char> blob;
+
+    column()
+        : type(column_int)
+    {}
+
+    column(const std::string &_name, column_type_t _type)
+        : name(_name), type(_type)
+    {
+        if(type==column_string){
+            offsets.push_back(0);
+        }
+    }
+
+    size_t size()const
+    {
+        switch(type)
+        {
+            case column_int: return ints.size();
+            case column_float: return floats.size();
+            case column_bool: return bools.size();
+            case column_string: return offsets.size()-1;
+        }
+        return 0;
+    }
+
+    immutable_range str(size_t row)const
+    {
+        if(blob.empty()){
+            return emptyrange();
+        }
+        return immutable_range(&blob[0]+offsets[row], &blob[0]+offsets[row+1]);
+    }
+
+    void push_str(const immutable_range &r)
+    {
+        blob.insert(blob.end(), r.begin(), r.end());
+        offsets.push_back(blob.size());
+    }
+
+    void promote_to_float()
+    {
+        assert(type==column_int);
+        floats.assign(ints.begin(), ints.end());
+        ints.clear();
+        type=column_float;
+    }
+};
+
+
+class column_table
+{
+    std::vector<column> m_columns;
+    size_t m_rows;
+
+public:
+    column_table()
+        : m_rows(0)
+    {}
+
+    size_t rows()const{ return m_rows; }
+    std::vector<column> &get_columns(){ return m_columns; }
+    const std::vector<column> &get_columns()const{ return m_columns; }
+
+    const column *find(const std::string &name)const
+    {
+        for(auto it=m_columns.begin(); it!=m_columns.end(); ++it){
+            if(it->name==name){
+                return &*it;
+            }
+        }
+        return 0;
+    }
+
+    /// array of maps that share one key set to columns.
+    /// keys may come in any order, int columns become float when a float shows up.
+    void load(const immutable_range &packed)
+    {
+        m_columns.clear();
+        m_rows=0;
+
+        unpacker u(packed.begin(), packed.end());
+        if(!u.is_array()){
+            throw incompatible_unpack_type(__FUNCTION__);
+        }
+        auto rows=array();
+        u >> rows;
+
+        // the row each column was last written
+        std::vector<size_t> written;
+        for(size_t row=0; row<rows.size; ++row){
+            if(!u.is_map()){
+                throw incompatible_unpack_type(__FUNCTION__);
+            }
+            auto fields=map();
+            u >> fields;
+            if(row>0 && fields.size!=m_columns.size()){
+                throw unpack_error("key set mismatch");
+            }
+
+            for(size_t i=0; i<fields.size; ++i){
+                immutable_range key;
+                auto key_buffer=create_view_buffer(key);
+                u.unpack(key_buffer);
+
+                if(row==0){
+                    for(auto it=m_columns.begin(); it!=m_columns.end(); ++it){
+                        if(key==it->name){
+                            throw unpack_error("duplicated key");
+                        }
+                    }
+                    m_columns.push_back(column(key.to_str(), column_type_of(u)));
+                    written.push_back(0);
+                    push_value(m_columns.back(), u);
+                    continue;
+                }
+
+                // same order as the first row in the usual case
+                size_t index=i;
+                if(!(key==m_columns[index].name)){
+                    for(index=0; index<m_columns.size(); ++index){
+                        if(key==m_columns[index].name){
+                            break;
+                        }
+                    }
+                    if(index==m_columns.size()){
+                        throw unpack_error("key set mismatch");
+                    }
+                }
+                if(written[index]==row){
+                    throw unpack_error("duplicated key");
+                }
+                written[index]=row;
+                push_value(m_columns[index], u);
+            }
+            m_rows=row+1;
+        }
+    }
+
+    /// columns back to an array of maps
+    void pack(packer &p)const
+    {
+        p << array(m_rows);
+        for(size_t row=0; row<m_rows; ++row){
+            p << map(m_columns.size());
+            for(auto it=m_columns.begin(); it!=m_columns.end(); ++it){
+                p.pack_str(it->name.c_str(), it->name.size());
+                switch(it->type)
+                {
+                    case column_int:
+                        p.pack_int(it->ints[row]);
+                        break;
+
+                    case column_float:
+                        p.pack_double(it->floats[row]);
+                        break;
+
+                    case column_bool:
+                        p.pack_bool(it->bools[row]!=0);
+                        break;
+
+                    case column_string:
+                        {
+                            auto s=it->str(row);
+                            p.pack_str((const char*)s.begin(), s.size());
+                        }
+                        break;
+                }
+            }
+        }
+    }
+
+private:
+    static column_type_t column_type_of(unpacker &u)
+    {
+        if(u.is_integer()){
+            return column_int;
+        }
+        if(u.is_float()){
+            return column_float;
+        }
+        if(u.is_bool()){
+            return column_bool;
+        }
+        if(u.is_str()){
+            return column_string;
+        }
+        throw incompatible_unpack_type(__FUNCTION__);
+    }
+
+    static void push_value(column &c, unpacker &u)
+    {
+        switch(c.type)
+        {
+            case column_int:
+                if(u.is_integer()){
+                    long long n;
+                    u >> n;
+                    c.ints.push_back(n);
+                    return;
+                }
+                if(u.is_float()){
+                    c.promote_to_float();
+                    push_value(c, u);
+                    return;
+                }
+                break;
+
+            case column_float:
+                if(u.is_float() || u.is_integer()){
+                    double n;
+                    u >> n;
+                    c.floats.push_back(n);
+                    return;
+                }
+                break;
+
+            case column_bool:
+                if(u.is_bool()){
+                    bool b;
+                    u >> b;
+                    c.bools.push_back(b ? 1 : 0);
+                    return;
+                }
+                break;
+
+            case column_string:
+                if(u.is_str()){
+                    immutable_range s;
+                    auto buffer=create_view_buffer(s);
+                    u.unpack(buffer);
+                    c.push_str(s);
+                    return;
+                }
+                break;
+        }
+        throw incompatible_unpack_type(__FUNCTION__);
+    }
+};
+
+
+} // namespace
+} // namespace
@@ -0,0 +1,227 @@
+#pragma once
+#include "../msgpack.h"
+#include <string>
+#include <vector>
+#include <string.h>
+//
+// runtime for the decoders generated by scripts/generate_decoder.py
+//
+
+namespace refrange {
+namespace msgpack {
+namespace generated {
+
+
+struct shape_mismatch: public unpack_error
+{
+    shape_mismatch(const std::string &message)
+        : unpack_error(message)
+    {}
+};
+
+
+template<typename T>
+inline T load(const unsigned char *p)
+{
+    T t;
+    memcpy(&t, p, sizeof(T));
+    return t;
+}
+
+inline void require(const unsigned char *p, const unsigned char *end, size_t size)
+{
+    if(static_cast<size_t>(end-p)<size){
+        throw std::range_error(__FUNCTION__);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// decode
+//////////////////////////////////////////////////////////////////////////////
+inline const unsigned char *read_array_head(const unsigned char *p, const unsigned char *end, size_t size)
+{
+    require(p, end, 1);
+    size_t n;
+    if(fixarray_tag::is_match(*p)){
+        n=*p & ~fixarray_tag::mask;
+        p+=1;
+    }
+    else if(*p==array16_tag::bits){
+        require(p, end, 3);
+        n=load<unsigned short>(p+1);
+        p+=3;
+    }
+    else if(*p==array32_tag::bits){
+        require(p, end, 5);
+        n=load<unsigned int>(p+1);
+        p+=5;
+    }
+    else{
+        throw shape_mismatch("array expected");
+    }
+    if(n!=size){
+        throw shape_mismatch("array size");
+    }
+    return p;
+}
+
+/// pairs
+inline const unsigned char *read_map_head(const unsigned char *p, const unsigned char *end, size_t size)
+{
+    require(p, end, 1);
+    size_t n;
+    if(fixmap_tag::is_match(*p)){
+        n=*p & ~fixmap_tag::mask;
+        p+=1;
+    }
+    else if(*p==map16_tag::bits){
+        require(p, end, 3);
+        n=load<unsigned short>(p+1);
+        p+=3;
+    }
+    else if(*p==map32_tag::bits){
+        require(p, end, 5);
+        n=load<unsigned int>(p+1);
+        p+=5;
+    }
+    else{
+        throw shape_mismatch("map expected");
+    }
+    if(n!=size){
+        throw shape_mismatch("map size");
+    }
+    return p;
+}
+
+inline const unsigned char *read_str_head(const unsigned char *p, const unsigned char *end, size_t &len)
+{
+    require(p, end, 1);
+    if(fixstr_tag::is_match(*p)){
+        len=*p & ~fixstr_tag::mask;
+        p+=1;
+    }
+    else if(*p==str8_tag::bits){
+        require(p, end, 2);
+        len=p[1];
+        p+=2;
+    }
+    else if(*p==str16_tag::bits){
+        require(p, end, 3);
+        len=load<unsigned short>(p+1);
+        p+=3;
+    }
+    else if(*p==str32_tag::bits){
+        require(p, end, 5);
+        len=load<unsigned int>(p+1);
+        p+=5;
+    }
+    else{
+        throw shape_mismatch("string expected");
+    }
+    require(p, end, len);
+    return p;
+}
+
+/// the key has to be the expected one
+inline const unsigned char *read_key(const unsigned char *p, const unsigned char *end, const char *key, size_t key_len)
+{
+    size_t len;
+    p=read_str_head(p, end, len);
+    if(len!=key_len || memcmp(p, key, len)!=0){
+        throw shape_mismatch(key);
+    }
+    return p+len;
+}
+
+template<typename T>
+inline const unsigned char *read_int(const unsigned char *p, const unsigned char *end, T &t)
+{
+    require(p, end, 1);
+    auto b=*p;
+    if(positive_fixint_tag::is_match(b)){
+        t=static_cast<T>(b);
+        return p+1;
+    }
+    if(negative_fixint_tag::is_match(b)){
+        t=static_cast<T>(-static_cast<int>(b & ~negative_fixint_tag::mask));
+        return p+1;
+    }
+    switch(b)
+    {
+        case uint8_tag::bits: require(p, end, 2); t=static_cast<T>(p[1]); return p+2;
+        case uint16_tag::bits: require(p, end, 3); t=static_cast<T>(load<unsigned short>(p+1)); return p+3;
+        case uint32_tag::bits: require(p, end, 5); t=static_cast<T>(load<unsigned int>(p+1)); return p+5;
+        case uint64_tag::bits: require(p, end, 9); t=static_cast<T>(load<unsigned long long>(p+1)); return p+9;
+        case int8_tag::bits: require(p, end, 2); t=static_cast<T>(static_cast<signed char>(p[1])); return p+2;
+        case int16_tag::bits: require(p, end, 3); t=static_cast<T>(load<short>(p+1)); return p+3;
+        case int32_tag::bits: require(p, end, 5); t=static_cast<T>(load<int>(p+1)); return p+5;
+        case int64_tag::bits: require(p, end, 9); t=static_cast<T>(load<long long>(p+1)); return p+9;
+    }
+    throw shape_mismatch("int expected");
+}
+
+template<typename T>
+inline const unsigned char *read_float(const unsigned char *p, const unsigned char *end, T &t)
+{
+    require(p, end, 1);
+    switch(*p)
+    {
+        case float32_tag::bits: require(p, end, 5); t=static_cast<T>(load<float>(p+1)); return p+5;
+        case float64_tag::bits: require(p, end, 9); t=static_cast<T>(load<double>(p+1)); return p+9;
+    }
+    throw shape_mismatch("float expected");
+}
+
+inline const unsigned char *read_bool(const unsigned char *p, const unsigned char *end, bool &t)
+{
+    require(p, end, 1);
+    switch(*p)
+    {
+        case true_tag::bits: t=true; return p+1;
+        case false_tag::bits: t=false; return p+1;
+    }
+    throw shape_mismatch("bool expected");
+}
+
+inline const unsigned char *read_str(const unsigned char *p, const unsigned char *end, std::string &t)
+{
+    size_t len;
+    p=read_str_head(p, end, len);
+    t.assign((const char*)p, len);
+    return p+len;
+}
+
+inline const unsigned char *read_bin(const unsigned char *p, const unsigned char *end, std::vector<unsigned char> &t)
+{
+    require(p, end, 1);
+    size_t len;
+    switch(*p)
+    {
+        case bin8_tag::bits: require(p, end, 2); len=p[1]; p+=2; break;
+        case bin16_tag::bits: require(p, end, 3); len=load<unsigned short>(p+1); p+=3; break;
+        case bin32_tag::bits: require(p, end, 5); len=load<unsigned int>(p+1); p+=5; break;
+        default:
+            throw shape_mismatch("byte[] expected");
+    }
+    require(p, end, len);
+    t.assign(p, p+len);
+    return p+len;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// encode
+//////////////////////////////////////////////////////////////////////////////
+/// a value packed ahead (a key)
+inline packer &write_packed(packer &p, const unsigned char *packed, size_t len)
+{
+    p.new_item();
+    p.write(packed, len);
+    return p;
+}
+
+
+} // namespace
+} // namespace
+} // namespace
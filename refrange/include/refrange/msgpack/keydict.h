@@ -0,0 +1,255 @@
+#pragma once
+#include "../msgpack.h"
+#include "basic_overload.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace refrange {
+namespace msgpack {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// map key dictionary
+//////////////////////////////////////////////////////////////////////////////
+// A dictionary shared across one stream. Nothing is sent ahead:
+// the first time a key is seen it is packed as a plain str and both sides
+// append it to their dictionary. A key seen again is packed as
+// fixext(1|2|4)[ext_type] holding the dictionary index.
+//
+// Keys must be decoded in the same order as they were encoded.
+// Encoder and decoder have to agree on ext_type and max_entries.
+enum key_dictionary_defaults_t
+{
+    key_dictionary_ext_type=1,
+    key_dictionary_max_entries=4096,
+};
+
+
+class key_encoder
+{
+    signed char m_type;
+    size_t m_max;
+    std::unordered_map<std::string, unsigned int> m_map;
+
+public:
+    key_encoder(signed char type=key_dictionary_ext_type
+            , size_t max_entries=key_dictionary_max_entries)
+        : m_type(type), m_max(max_entries)
+    {}
+
+    size_t size()const{ return m_map.size(); }
+
+    void clear(){ m_map.clear(); }
+
+    packer &pack_key(packer &p, const char *key, size_t len)
+    {
+        std::string s(key, key+len);
+        auto found=m_map.find(s);
+        if(found==m_map.end()){
+            if(m_map.size()<m_max){
+                auto index=static_cast<unsigned int>(m_map.size());
+                m_map.insert(std::make_pair(s, index));
+            }
+            return p.pack_str(key, len);
+        }
+        return pack_ref(p, found->second);
+    }
+
+    packer &pack_key(packer &p, const std::string &key)
+    {
+        return pack_key(p, key.c_str(), key.size());
+    }
+
+private:
+    packer &pack_ref(packer &p, unsigned int index)
+    {
+        if(index<=0xff){
+            auto n=static_cast<unsigned char>(index);
+            return p.pack_ext(m_type, (const unsigned char*)&n, sizeof(n));
+        }
+        else if(index<=0xffff){
+            auto n=static_cast<unsigned short>(index);
+            return p.pack_ext(m_type, (const unsigned char*)&n, sizeof(n));
+        }
+        else{
+            return p.pack_ext(m_type, (const unsigned char*)&index, sizeof(index));
+        }
+    }
+};
+
+
+class key_decoder
+{
+    signed char m_type;
+    size_t m_max;
+    // views into the decoded stream. the stream must outlive the decoder.
+    std::vector<immutable_range> m_keys;
+
+public:
+    key_decoder(signed char type=key_dictionary_ext_type
+            , size_t max_entries=key_dictionary_max_entries)
+        : m_type(type), m_max(max_entries)
+    {}
+
+    size_t size()const{ return m_keys.size(); }
+
+    void clear(){ m_keys.clear(); }
+
+    /// plain str or dictionary reference to a zero-copy view
+    unpacker &unpack_key(unpacker &u, immutable_range &key)
+    {
+        if(u.is_str()){
+            auto buffer=create_view_buffer(key);
+            u.unpack(buffer);
+            if(m_keys.size()<m_max){
+                m_keys.push_back(key);
+            }
+            return u;
+        }
+
+        if(!u.is_ext()){
+            throw incompatible_unpack_type(__FUNCTION__);
+        }
+        signed char type;
+        immutable_range data;
+        auto buffer=create_ext_view_buffer(type, data);
+        u.unpack(buffer);
+        if(type!=m_type){
+            throw incompatible_unpack_type(__FUNCTION__);
+        }
+
+        size_t index;
+        switch(data.size())
+        {
+            case 1: index=*data.begin(); break;
+            case 2: index=*((unsigned short*)data.begin()); break;
+            case 4: index=*((unsigned int*)data.begin()); break;
+            default:
+                throw unpack_error("invalid key reference");
+        }
+        if(index>=m_keys.size()){
+            throw unpack_error("unknown key reference");
+        }
+        key=m_keys[index];
+        return u;
+    }
+
+    unpacker &unpack_key(unpacker &u, std::string &key)
+    {
+        immutable_range r;
+        unpack_key(u, r);
+        key=r.to_str();
+        return u;
+    }
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+// transcode a whole value
+//////////////////////////////////////////////////////////////////////////////
+namespace detail {
+
+inline void pack_empty_collection(packer &p, bool is_map)
+{
+    // begin_collection does not close an empty collection
+    p.new_item();
+    p.write_value(static_cast<unsigned char>(is_map ? fixmap_tag::bits : fixarray_tag::bits));
+}
+
+inline void copy_scalar(unpacker &u, packer &p)
+{
+    auto begin=u.range().get_current();
+    u.skip();
+    p.new_item();
+    p.write(begin, u.range().get_current()-begin);
+}
+
+} // namespace
+
+
+/// plain msgpack to key dictionary encoded
+inline void encode_keys(unpacker &u, packer &p, key_encoder &keys)
+{
+    if(u.is_array()){
+        auto c=array();
+        u >> c;
+        if(c.size==0){
+            detail::pack_empty_collection(p, false);
+            return;
+        }
+        p << array(c.size);
+        for(size_t i=0; i<c.size; ++i){
+            encode_keys(u, p, keys);
+        }
+    }
+    else if(u.is_map()){
+        auto c=map();
+        u >> c;
+        if(c.size==0){
+            detail::pack_empty_collection(p, true);
+            return;
+        }
+        p << map(c.size);
+        for(size_t i=0; i<c.size; ++i){
+            if(u.is_str()){
+                immutable_range key;
+                auto buffer=create_view_buffer(key);
+                u.unpack(buffer);
+                keys.pack_key(p, (const char*)key.begin(), key.size());
+            }
+            else{
+                // non str keys are left as is
+                encode_keys(u, p, keys);
+            }
+            encode_keys(u, p, keys);
+        }
+    }
+    else{
+        detail::copy_scalar(u, p);
+    }
+}
+
+/// key dictionary encoded to plain msgpack
+inline void decode_keys(unpacker &u, packer &p, key_decoder &keys)
+{
+    if(u.is_array()){
+        auto c=array();
+        u >> c;
+        if(c.size==0){
+            detail::pack_empty_collection(p, false);
+            return;
+        }
+        p << array(c.size);
+        for(size_t i=0; i<c.size; ++i){
+            decode_keys(u, p, keys);
+        }
+    }
+    else if(u.is_map()){
+        auto c=map();
+        u >> c;
+        if(c.size==0){
+            detail::pack_empty_collection(p, true);
+            return;
+        }
+        p << map(c.size);
+        for(size_t i=0; i<c.size; ++i){
+            if(u.is_str() || u.is_ext()){
+                immutable_range key;
+                keys.unpack_key(u, key);
+                p.pack_str((const char*)key.begin(), key.size());
+            }
+            else{
+                decode_keys(u, p, keys);
+            }
+            decode_keys(u, p, keys);
+        }
+    }
+    else{
+        detail::copy_scalar(u, p);
+    }
+}
+
+
+} // namespace
+} // namespace
@@ -0,0 +1,91 @@
+#pragma once
+#include "../msgpack.h"
+#include "../thread_pool.h"
+#include "basic_overload.h"
+#include <vector>
+
+namespace refrange {
+namespace msgpack {
+
+
+/// element ranges of a packed top-level array.
+/// the boundaries are found with skip_value, the elements are not decoded.
+inline std::vector<immutable_range> split_array(const immutable_range &packed)
+{
+    std::vector<immutable_range> elements;
+    if(!packed){
+        return elements;
+    }
+
+    unpacker u(packed.begin(), packed.end());
+    if(!u.is_array()){
+        throw incompatible_unpack_type(__FUNCTION__);
+    }
+    auto c=array();
+    u >> c;
+
+    elements.reserve(c.size);
+    auto p=u.range().get_current();
+    for(size_t i=0; i<c.size; ++i){
+        auto next=skip_value(p, packed.end());
+        elements.push_back(immutable_range(p, next));
+        p=next;
+    }
+    return elements;
+}
+
+
+template<typename T>
+struct default_decoder
+{
+    T operator()(unpacker &u)const
+    {
+        T t;
+        u >> t;
+        return t;
+    }
+};
+
+
+/// visitor(size_t index, unpacker &u) is called for each element of the array.
+/// contiguous chunks of elements run on the pool, the order between chunks is undefined.
+template<typename F>
+inline void parallel_visit(thread_pool &pool, const immutable_range &packed, F visitor
+        , size_t chunks=0)
+{
+    auto elements=split_array(packed);
+    parallel_for(pool, elements.size(), chunks, [&elements, &visitor](size_t begin, size_t end){
+        for(size_t i=begin; i<end; ++i){
+            unpacker u(elements[i].begin(), elements[i].end());
+            visitor(i, u);
+        }
+    });
+}
+
+
+/// decoder(unpacker &u) returns a T for each element of the array.
+/// the results are in the element order.
+template<typename T, typename F>
+inline std::vector<T> parallel_unpack(thread_pool &pool, const immutable_range &packed, F decoder
+        , size_t chunks=0)
+{
+    auto elements=split_array(packed);
+    std::vector<T> results(elements.size());
+    parallel_for(pool, elements.size(), chunks, [&elements, &results, &decoder](size_t begin, size_t end){
+        for(size_t i=begin; i<end; ++i){
+            unpacker u(elements[i].begin(), elements[i].end());
+            results[i]=decoder(u);
+        }
+    });
+    return results;
+}
+
+template<typename T>
+inline std::vector<T> parallel_unpack(thread_pool &pool, const immutable_range &packed)
+{
+    return parallel_unpack<T>(pool, packed, default_decoder<T>());
+}
+
+
+} // namespace
+} // namespace
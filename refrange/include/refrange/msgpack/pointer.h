@@ -0,0 +1,191 @@
+#pragma once
+#include "query.h"
+#include <string>
+#include <vector>
+
+namespace refrange {
+namespace msgpack {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// json pointer over packed values
+//
+// pointer     := ('/' token)*          RFC 6901. '~0' is '~', '~1' is '/'
+// dotted path := key ('.' key | '[' index ']')*
+//
+// example: /bones/3/name, bones[3].name, bones.3.name
+//
+// a numeric token is an index for an array and a key for a map.
+// the siblings on the way are skipped without decoding.
+//////////////////////////////////////////////////////////////////////////////
+struct pointer_error: public std::invalid_argument
+{
+    pointer_error(const std::string &message)
+        : std::invalid_argument(message)
+    {}
+};
+
+
+class pointer
+{
+    struct token
+    {
+        std::string key;
+        // for an array
+        size_t index;
+        bool is_index;
+
+        token(const std::string &_key)
+            : key(_key), index(0), is_index(false)
+        {
+            if(key.empty() || key.size()>18 || (key[0]=='0' && key.size()>1)){
+                return;
+            }
+            for(auto it=key.begin(); it!=key.end(); ++it){
+                if(*it<'0' || *it>'9'){
+                    return;
+                }
+                index=index*10+(*it-'0');
+            }
+            is_index=true;
+        }
+    };
+    std::vector<token> m_tokens;
+
+public:
+    /// the whole value
+    pointer()
+    {}
+
+    size_t size()const{ return m_tokens.size(); }
+    const std::string &key(size_t i)const{ return m_tokens[i].key; }
+
+    void push(const std::string &key)
+    {
+        m_tokens.push_back(token(key));
+    }
+
+    /// RFC 6901
+    static pointer compile(const std::string &src)
+    {
+        pointer ptr;
+        size_t pos=0;
+        while(pos<src.size()){
+            if(src[pos]!='/'){
+                throw pointer_error("'/' expected: "+src);
+            }
+            ++pos;
+            std::string key;
+            for(; pos<src.size() && src[pos]!='/'; ++pos){
+                if(src[pos]!='~'){
+                    key.push_back(src[pos]);
+                    continue;
+                }
+                ++pos;
+                if(pos<src.size() && src[pos]=='0'){
+                    key.push_back('~');
+                }
+                else if(pos<src.size() && src[pos]=='1'){
+                    key.push_back('/');
+                }
+                else{
+                    throw pointer_error("invalid escape: "+src);
+                }
+            }
+            ptr.push(key);
+        }
+        return ptr;
+    }
+
+    /// a.b[0].c
+    static pointer compile_dotted(const std::string &src)
+    {
+        pointer ptr;
+        size_t pos=0;
+        bool expect_key=true;
+        while(pos<src.size()){
+            if(src[pos]=='['){
+                auto close=src.find(']', pos);
+                if(close==std::string::npos || close==pos+1){
+                    throw pointer_error("invalid index: "+src);
+                }
+                token t(src.substr(pos+1, close-pos-1));
+                if(!t.is_index){
+                    throw pointer_error("invalid index: "+src);
+                }
+                ptr.m_tokens.push_back(t);
+                pos=close+1;
+                expect_key=false;
+                continue;
+            }
+            if(!expect_key){
+                if(src[pos]!='.'){
+                    throw pointer_error("'.' expected: "+src);
+                }
+                ++pos;
+                if(pos==src.size()){
+                    // trailing '.'
+                    throw pointer_error("key expected: "+src);
+                }
+            }
+            auto end=src.find_first_of(".[", pos);
+            if(end==std::string::npos){
+                end=src.size();
+            }
+            if(end==pos){
+                throw pointer_error("key expected: "+src);
+            }
+            ptr.push(src.substr(pos, end-pos));
+            pos=end;
+            expect_key=false;
+        }
+        return ptr;
+    }
+
+    /// the packed target value at the head of packed. false if it does not exist.
+    bool resolve(const immutable_range &packed, immutable_range &value)const
+    {
+        auto p=packed.begin();
+        auto end=packed.end();
+        for(auto it=m_tokens.begin(); it!=m_tokens.end(); ++it){
+            if(p>=end){
+                throw std::range_error(__FUNCTION__);
+            }
+            if(query::is_map_head(*p)){
+                p=query::find_key(p, end, (const unsigned char*)it->key.c_str(), it->key.size());
+            }
+            else if(it->is_index){
+                p=query::find_index(p, end, it->index);
+            }
+            else{
+                p=0;
+            }
+            if(!p){
+                return false;
+            }
+        }
+        value=immutable_range(p, skip_value(p, end));
+        return true;
+    }
+
+    /// an empty range if it does not exist
+    immutable_range find(const immutable_range &packed)const
+    {
+        immutable_range value;
+        if(!resolve(packed, value)){
+            return immutable_range();
+        }
+        return value;
+    }
+};
+
+
+/// compiles each time. keep a pointer for repeated lookups.
+inline bool resolve(const immutable_range &packed, const std::string &json_pointer, immutable_range &value)
+{
+    return pointer::compile(json_pointer).resolve(packed, value);
+}
+
+
+} // namespace
+} // namespace
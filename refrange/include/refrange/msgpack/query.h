@@ -0,0 +1,679 @@
+#pragma once
+#include "../msgpack.h"
+#include "basic_overload.h"
+#include "utility.h"
+#include <string>
+#include <vector>
+#include <sstream>
+
+namespace refrange {
+namespace msgpack {
+namespace query {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// path query over packed values
+//
+// query      := step* projection?
+// step       := '.' key | '."' quoted key '"' | '.*' | '[' index ']' | '[*]'
+//             | '[?' path op literal ']'
+// op         := '==' | '!=' | '<' | '<=' | '>' | '>='
+// literal    := number | '"' string '"' | true | false | null
+// projection := '{' key (',' key)* '}'
+//
+// example: .records[*][?.level=="error"]{time,message}
+//////////////////////////////////////////////////////////////////////////////
+struct query_error: public std::invalid_argument
+{
+    query_error(const std::string &message)
+        : std::invalid_argument(message)
+    {}
+};
+
+
+enum literal_t
+{
+    literal_nil,
+    literal_bool,
+    literal_int,
+    literal_float,
+    literal_string,
+};
+
+struct literal
+{
+    literal_t type;
+    bool b;
+    long long i;
+    double f;
+    std::string s;
+
+    literal()
+        : type(literal_nil), b(false), i(0), f(0)
+    {}
+};
+
+
+enum op_t
+{
+    op_eq,
+    op_ne,
+    op_lt,
+    op_le,
+    op_gt,
+    op_ge,
+};
+
+
+enum step_t
+{
+    step_key,
+    step_index,
+    step_wildcard,
+    step_filter,
+};
+
+struct step
+{
+    step_t type;
+    std::string key;
+    size_t index;
+
+    // step_filter
+    std::vector<step> path;
+    op_t op;
+    literal value;
+
+    step()
+        : type(step_key), index(0), op(op_eq)
+    {}
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+// packed value helpers
+//////////////////////////////////////////////////////////////////////////////
+inline bool is_map_head(unsigned char b)
+{
+    return fixmap_tag::is_match(b) || b==map16_tag::bits || b==map32_tag::bits;
+}
+
+inline bool is_array_head(unsigned char b)
+{
+    return fixarray_tag::is_match(b) || b==array16_tag::bits || b==array32_tag::bits;
+}
+
+inline bool is_str_head(unsigned char b)
+{
+    return fixstr_tag::is_match(b) || b==str8_tag::bits || b==str16_tag::bits || b==str32_tag::bits;
+}
+
+/// value of the key in the packed map at p, 0 if not found.
+/// the values of the other keys are skipped.
+/// throws std::range_error when the map is cut short.
+inline const unsigned char *find_key(const unsigned char *p, const unsigned char *end
+        , const unsigned char *key, size_t key_len)
+{
+    if(p>=end){
+        throw std::range_error(__FUNCTION__);
+    }
+    if(!is_map_head(*p)){
+        return 0;
+    }
+    auto head=scan_head(p, end);
+    p+=head.header;
+    for(size_t i=0; i<head.children; i+=2){
+        auto key_head=scan_head(p, end);
+        if(key_head.payload>static_cast<size_t>(end-p)-key_head.header){
+            throw std::range_error(__FUNCTION__);
+        }
+        auto value=p+key_head.header+key_head.payload;
+        if(value>=end){
+            // no value for the last key
+            throw std::range_error(__FUNCTION__);
+        }
+        if(is_str_head(*p) && key_head.payload==key_len
+                && std::equal(key, key+key_len, p+key_head.header)){
+            return value;
+        }
+        p=skip_value(value, end);
+    }
+    return 0;
+}
+
+/// element index of the packed array at p, 0 if out of range.
+/// throws std::range_error when the array is cut short.
+inline const unsigned char *find_index(const unsigned char *p, const unsigned char *end
+        , size_t index)
+{
+    if(p>=end){
+        throw std::range_error(__FUNCTION__);
+    }
+    if(!is_array_head(*p)){
+        return 0;
+    }
+    auto head=scan_head(p, end);
+    if(index>=head.children){
+        return 0;
+    }
+    p+=head.header;
+    for(size_t i=0; i<index; ++i){
+        p=skip_value(p, end);
+    }
+    return p;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// compiler
+//////////////////////////////////////////////////////////////////////////////
+class compiler
+{
+    const std::string &m_src;
+    size_t m_pos;
+
+public:
+    compiler(const std::string &src)
+        : m_src(src), m_pos(0)
+    {}
+
+    void compile(std::vector<step> &steps, std::vector<std::string> &projection)
+    {
+        parse_path(steps, true);
+        skip_space();
+        if(peek()=='{'){
+            ++m_pos;
+            while(true){
+                skip_space();
+                projection.push_back(parse_key());
+                skip_space();
+                char c=get();
+                if(c=='}'){
+                    break;
+                }
+                if(c!=','){
+                    error("',' or '}' expected");
+                }
+            }
+        }
+        skip_space();
+        if(m_pos!=m_src.size()){
+            error("unexpected character");
+        }
+    }
+
+private:
+    char peek()const{ return m_pos<m_src.size() ? m_src[m_pos] : '\0'; }
+
+    char get()
+    {
+        if(m_pos>=m_src.size()){
+            error("unexpected end");
+        }
+        return m_src[m_pos++];
+    }
+
+    void skip_space()
+    {
+        while(m_pos<m_src.size() && (m_src[m_pos]==' ' || m_src[m_pos]=='\t')){
+            ++m_pos;
+        }
+    }
+
+    void error(const char *message)const
+    {
+        std::stringstream ss;
+        ss << message << " at " << m_pos << ": " << m_src;
+        throw query_error(ss.str());
+    }
+
+    static bool is_key_char(char c)
+    {
+        return (c>='a' && c<='z') || (c>='A' && c<='Z') || (c>='0' && c<='9')
+            || c=='_' || c=='-' || c=='$';
+    }
+
+    std::string parse_quoted()
+    {
+        // drop open quote
+        get();
+        std::string s;
+        while(true){
+            char c=get();
+            if(c=='"'){
+                break;
+            }
+            if(c=='\\'){
+                c=get();
+            }
+            s.push_back(c);
+        }
+        return s;
+    }
+
+    std::string parse_key()
+    {
+        if(peek()=='"'){
+            return parse_quoted();
+        }
+        auto begin=m_pos;
+        while(is_key_char(peek())){
+            ++m_pos;
+        }
+        if(begin==m_pos){
+            error("key expected");
+        }
+        return m_src.substr(begin, m_pos-begin);
+    }
+
+    size_t parse_index()
+    {
+        if(!(peek()>='0' && peek()<='9')){
+            error("index expected");
+        }
+        size_t n=0;
+        while(peek()>='0' && peek()<='9'){
+            n=n*10+(get()-'0');
+        }
+        return n;
+    }
+
+    // filters are only allowed at the top level
+    void parse_path(std::vector<step> &steps, bool allow_filter)
+    {
+        while(true){
+            skip_space();
+            char c=peek();
+            if(c=='.'){
+                ++m_pos;
+                step s;
+                if(peek()=='*'){
+                    ++m_pos;
+                    s.type=step_wildcard;
+                }
+                else{
+                    s.type=step_key;
+                    s.key=parse_key();
+                }
+                steps.push_back(s);
+            }
+            else if(c=='['){
+                ++m_pos;
+                skip_space();
+                step s;
+                if(peek()=='*'){
+                    ++m_pos;
+                    s.type=step_wildcard;
+                }
+                else if(peek()=='?'){
+                    if(!allow_filter){
+                        error("nested filter");
+                    }
+                    ++m_pos;
+                    s.type=step_filter;
+                    parse_path(s.path, false);
+                    skip_space();
+                    s.op=parse_op();
+                    skip_space();
+                    s.value=parse_literal();
+                }
+                else{
+                    s.type=step_index;
+                    s.index=parse_index();
+                }
+                skip_space();
+                if(get()!=']'){
+                    error("']' expected");
+                }
+                steps.push_back(s);
+            }
+            else{
+                return;
+            }
+        }
+    }
+
+    op_t parse_op()
+    {
+        char c=get();
+        char n=peek();
+        switch(c)
+        {
+            case '=':
+                if(n=='='){ ++m_pos; return op_eq; }
+                break;
+            case '!':
+                if(n=='='){ ++m_pos; return op_ne; }
+                break;
+            case '<':
+                if(n=='='){ ++m_pos; return op_le; }
+                return op_lt;
+            case '>':
+                if(n=='='){ ++m_pos; return op_ge; }
+                return op_gt;
+        }
+        error("operator expected");
+        return op_eq;
+    }
+
+    literal parse_literal()
+    {
+        literal l;
+        char c=peek();
+        if(c=='"'){
+            l.type=literal_string;
+            l.s=parse_quoted();
+            return l;
+        }
+        if(c=='-' || (c>='0' && c<='9')){
+            auto begin=m_pos;
+            bool is_float=false;
+            ++m_pos;
+            while(true){
+                c=peek();
+                if(c=='.' || c=='e' || c=='E' || c=='+' || c=='-'){
+                    is_float=true;
+                }
+                else if(!(c>='0' && c<='9')){
+                    break;
+                }
+                ++m_pos;
+            }
+            std::istringstream ss(m_src.substr(begin, m_pos-begin));
+            if(is_float){
+                l.type=literal_float;
+                ss >> l.f;
+            }
+            else{
+                l.type=literal_int;
+                ss >> l.i;
+            }
+            // the whole token. 1-2 is not 1
+            if(ss.fail() || !ss.eof()){
+                error("invalid number");
+            }
+            return l;
+        }
+        auto word=parse_key();
+        if(word=="true" || word=="false"){
+            l.type=literal_bool;
+            l.b=word=="true";
+        }
+        else if(word=="null"){
+            l.type=literal_nil;
+        }
+        else{
+            error("literal expected");
+        }
+        return l;
+    }
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+// compiled query
+//////////////////////////////////////////////////////////////////////////////
+class matcher
+{
+    std::vector<step> m_steps;
+    std::vector<std::string> m_projection;
+
+public:
+    matcher()
+    {}
+
+    matcher(const std::string &src)
+    {
+        compiler(src).compile(m_steps, m_projection);
+    }
+
+    const std::vector<step> &get_steps()const{ return m_steps; }
+    const std::vector<std::string> &get_projection()const{ return m_projection; }
+
+    /// on_match(const immutable_range &value) is called for each matched value
+    /// of the single packed value at the head of r.
+    template<typename F>
+        void match(const immutable_range &r, F on_match)const
+        {
+            match(r.begin(), r.end(), 0, on_match);
+        }
+
+    /// same as match for each value of a stream of packed values
+    template<typename F>
+        void match_stream(const immutable_range &r, F on_match)const
+        {
+            auto p=r.begin();
+            while(p<r.end()){
+                match(p, r.end(), 0, on_match);
+                p=skip_value(p, r.end());
+            }
+        }
+
+    /// matched values are packed to out, projected when the query has a projection.
+    /// a match that is not a map projects to nil. one value per match.
+    /// returns the number of matches, which is the number of values packed.
+    size_t select(const immutable_range &r, packer &out)const
+    {
+        size_t count=0;
+        std::vector<unsigned char> projected;
+        match_stream(r, [&](const immutable_range &value){
+            ++count;
+            if(m_projection.empty()){
+                out.new_item();
+                out.write(value.begin(), value.size());
+                return;
+            }
+            project(value, out, projected);
+        });
+        return count;
+    }
+
+private:
+    template<typename F>
+        void match(const unsigned char *p, const unsigned char *end, size_t i, F &on_match)const
+        {
+            if(p>=end){
+                // cut short
+                throw std::range_error(__FUNCTION__);
+            }
+            if(i==m_steps.size()){
+                on_match(immutable_range(p, skip_value(p, end)));
+                return;
+            }
+
+            auto &s=m_steps[i];
+            switch(s.type)
+            {
+                case step_key:
+                    {
+                        auto found=find_key(p, end,
+                                (const unsigned char*)s.key.c_str(), s.key.size());
+                        if(found){
+                            match(found, end, i+1, on_match);
+                        }
+                    }
+                    break;
+
+                case step_index:
+                    {
+                        auto found=find_index(p, end, s.index);
+                        if(found){
+                            match(found, end, i+1, on_match);
+                        }
+                    }
+                    break;
+
+                case step_wildcard:
+                    {
+                        bool is_map=is_map_head(*p);
+                        if(!is_map && !is_array_head(*p)){
+                            break;
+                        }
+                        auto head=scan_head(p, end);
+                        p+=head.header;
+                        for(size_t j=0; j<head.children; ++j){
+                            if(is_map && j%2==0){
+                                // key
+                                p=skip_value(p, end);
+                                continue;
+                            }
+                            auto next=skip_value(p, end);
+                            match(p, end, i+1, on_match);
+                            p=next;
+                        }
+                    }
+                    break;
+
+                case step_filter:
+                    if(test(p, end, s)){
+                        match(p, end, i+1, on_match);
+                    }
+                    break;
+            }
+        }
+
+    static bool test(const unsigned char *p, const unsigned char *end, const step &s)
+    {
+        for(auto it=s.path.begin(); it!=s.path.end() && p; ++it){
+            if(it->type==step_key){
+                p=find_key(p, end, (const unsigned char*)it->key.c_str(), it->key.size());
+            }
+            else if(it->type==step_index){
+                p=find_index(p, end, it->index);
+            }
+            else{
+                return false;
+            }
+        }
+        if(!p){
+            return false;
+        }
+
+        int cmp;
+        if(!compare(p, end, s.value, cmp)){
+            // not comparable
+            return s.op==op_ne;
+        }
+        switch(s.op)
+        {
+            case op_eq: return cmp==0;
+            case op_ne: return cmp!=0;
+            case op_lt: return cmp<0;
+            case op_le: return cmp<=0;
+            case op_gt: return cmp>0;
+            case op_ge: return cmp>=0;
+        }
+        return false;
+    }
+
+    template<typename T>
+        static int three_way(const T &l, const T &r)
+        {
+            return l<r ? -1 : (r<l ? 1 : 0);
+        }
+
+    // only the scalar at p is decoded
+    static bool compare(const unsigned char *p, const unsigned char *end, const literal &l, int &cmp)
+    {
+        unpacker u(p, end);
+        switch(l.type)
+        {
+            case literal_nil:
+                cmp=0;
+                return u.is_nil();
+
+            case literal_bool:
+                if(!u.is_bool()){
+                    return false;
+                }
+                {
+                    bool b;
+                    u >> b;
+                    cmp=three_way(b, l.b);
+                }
+                return true;
+
+            case literal_int:
+                if(u.is_integer()){
+                    long long n;
+                    u >> n;
+                    cmp=three_way(n, l.i);
+                    return true;
+                }
+                if(u.is_float()){
+                    double n;
+                    u >> n;
+                    cmp=three_way(n, static_cast<double>(l.i));
+                    return true;
+                }
+                return false;
+
+            case literal_float:
+                if(u.is_integer() || u.is_float()){
+                    double n;
+                    u >> n;
+                    cmp=three_way(n, l.f);
+                    return true;
+                }
+                return false;
+
+            case literal_string:
+                if(!u.is_str()){
+                    return false;
+                }
+                {
+                    immutable_range s;
+                    auto buffer=create_view_buffer(s);
+                    u.unpack(buffer);
+                    auto begin=(const unsigned char*)l.s.c_str();
+                    auto end=begin+l.s.size();
+                    cmp=std::lexicographical_compare(s.begin(), s.end(), begin, end)
+                        ? -1
+                        : (s==l.s ? 0 : 1);
+                }
+                return true;
+        }
+        return false;
+    }
+
+    void project(const immutable_range &value, packer &out, std::vector<unsigned char> &body)const
+    {
+        if(!is_map_head(*value.begin())){
+            out.pack_nil();
+            return;
+        }
+        body.clear();
+        auto body_packer=create_external_vector_packer(body);
+        size_t pairs=0;
+        for(auto it=m_projection.begin(); it!=m_projection.end(); ++it){
+            auto found=find_key(value.begin(), value.end(),
+                    (const unsigned char*)it->c_str(), it->size());
+            if(!found){
+                continue;
+            }
+            body_packer.pack_str(it->c_str(), it->size());
+            body.insert(body.end(), found, skip_value(found, value.end()));
+            ++pairs;
+        }
+        if(pairs==0){
+            // empty map
+            out.new_item();
+            out.write_value(static_cast<unsigned char>(fixmap_tag::bits));
+            return;
+        }
+        out.begin_collection(collection_context(collection_context::collection_map,
+                    pairs*2, &body[0], body.size()));
+    }
+};
+
+
+/// compile once, match many buffers
+inline matcher compile(const std::string &src)
+{
+    return matcher(src);
+}
+
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,482 @@
+#pragma once
+#include "../msgpack.h"
+#include "../thread_pool.h"
+#include "../read_files.h"
+#include "basic_overload.h"
+#include <string>
+#include <vector>
+#include <limits>
+#include <ostream>
+
+namespace refrange {
+namespace msgpack {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// schema inference
+//////////////////////////////////////////////////////////////////////////////
+enum schema_type_t
+{
+    schema_nil,
+    schema_bool,
+    schema_int,
+    schema_float,
+    schema_str,
+    schema_bin,
+    schema_array,
+    schema_map,
+    schema_ext,
+    schema_type_count,
+};
+
+inline const char *schema_type_name(schema_type_t t)
+{
+    switch(t)
+    {
+        case schema_nil: return "nil";
+        case schema_bool: return "bool";
+        case schema_int: return "int";
+        case schema_float: return "float";
+        case schema_str: return "string";
+        case schema_bin: return "byte[]";
+        case schema_array: return "array";
+        case schema_map: return "map";
+        case schema_ext: return "ext";
+        default: return "unknown";
+    }
+}
+
+
+struct schema_field
+{
+    std::string name;
+    // maps that had the field
+    size_t count;
+    size_t node;
+    // the map that counted the field last. 1 origin, 0 for none
+    size_t last_map;
+
+    schema_field(const std::string &_name, size_t _node)
+        : name(_name), count(0), node(_node), last_map(0)
+    {}
+};
+
+
+/// aggregated statistics of the values seen at one place of the shape.
+/// a node may hold several types (union).
+struct schema_node
+{
+    static const size_t no_node=static_cast<size_t>(-1);
+    enum { histogram_size=33 };
+
+    size_t count;
+    size_t type_counts[schema_type_count];
+
+    // string and byte[]
+    size_t min_len;
+    size_t max_len;
+
+    // int. uint64 above the signed range is saturated.
+    long long min_int;
+    long long max_int;
+
+    double min_float;
+    double max_float;
+
+    // bucket 0 for empty, bucket k for lengths in [2^(k-1), 2^k)
+    size_t array_lengths[histogram_size];
+    // union of the elements
+    size_t items;
+
+    std::vector<schema_field> fields;
+
+    schema_node()
+        : count(0)
+        , min_len(std::numeric_limits<size_t>::max()), max_len(0)
+        , min_int(std::numeric_limits<long long>::max()), max_int(std::numeric_limits<long long>::min())
+        , min_float(std::numeric_limits<double>::max()), max_float(-std::numeric_limits<double>::max())
+        , items(no_node)
+    {
+        std::fill(type_counts, type_counts+schema_type_count, 0);
+        std::fill(array_lengths, array_lengths+histogram_size, 0);
+    }
+
+    bool has(schema_type_t t)const{ return type_counts[t]>0; }
+
+    /// field is missing in some of the maps
+    bool is_optional(const schema_field &f)const{ return f.count<type_counts[schema_map]; }
+
+    static size_t length_bucket(size_t len)
+    {
+        size_t bucket=0;
+        while(len && bucket<histogram_size-1){
+            len>>=1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    void add_len(size_t len)
+    {
+        min_len=std::min(min_len, len);
+        max_len=std::max(max_len, len);
+    }
+
+    void add_int(long long n)
+    {
+        min_int=std::min(min_int, n);
+        max_int=std::max(max_int, n);
+    }
+
+    void add_float(double n)
+    {
+        min_float=std::min(min_float, n);
+        max_float=std::max(max_float, n);
+    }
+};
+
+
+class schema
+{
+    // nodes[0] is the root. children are refered by index.
+    std::vector<schema_node> m_nodes;
+
+    struct frame
+    {
+        size_t node;
+        size_t remaining;
+        bool is_map;
+
+        frame(size_t _node, size_t _remaining, bool _is_map)
+            : node(_node), remaining(_remaining), is_map(_is_map)
+        {}
+    };
+    std::vector<frame> m_stack;
+
+public:
+    schema()
+        : m_nodes(1)
+    {}
+
+    size_t messages()const{ return m_nodes[0].count; }
+    const schema_node &root()const{ return m_nodes[0]; }
+    const schema_node &node(size_t index)const{ return m_nodes[index]; }
+
+    /// one message. no recursion, the nesting is kept on an explicit stack.
+    void add(unpacker &u)
+    {
+        m_stack.clear();
+        add_value(0, u);
+        while(!m_stack.empty()){
+            auto &top=m_stack.back();
+            if(top.remaining==0){
+                m_stack.pop_back();
+                continue;
+            }
+            --top.remaining;
+
+            if(!top.is_map){
+                add_value(m_nodes[top.node].items, u);
+                continue;
+            }
+
+            // key
+            std::string name;
+            if(u.is_str()){
+                u >> name;
+            }
+            else{
+                // non str keys are merged into one field
+                u.skip();
+                name="?";
+            }
+            auto child=get_field(top.node, name);
+            auto f=find_field(top.node, name);
+            // a duplicated key does not count twice
+            auto map_index=m_nodes[top.node].type_counts[schema_map];
+            if(f->last_map!=map_index){
+                f->last_map=map_index;
+                ++f->count;
+            }
+            add_value(child, u);
+        }
+    }
+
+    /// concatenated messages
+    void add_stream(const immutable_range &packed)
+    {
+        unpacker u(packed.begin(), packed.end());
+        while(!u.range().is_end()){
+            add(u);
+        }
+    }
+
+    /// other is added in
+    void merge(const schema &other)
+    {
+        std::vector<std::pair<size_t, size_t>> stack;
+        stack.push_back(std::make_pair(0, 0));
+        while(!stack.empty()){
+            auto dst_index=stack.back().first;
+            auto &src=other.m_nodes[stack.back().second];
+            stack.pop_back();
+
+            merge_node(m_nodes[dst_index], src);
+
+            if(src.items!=schema_node::no_node){
+                stack.push_back(std::make_pair(get_items(dst_index), src.items));
+            }
+            for(auto it=src.fields.begin(); it!=src.fields.end(); ++it){
+                auto child=get_field(dst_index, it->name);
+                find_field(dst_index, it->name)->count+=it->count;
+                stack.push_back(std::make_pair(child, it->node));
+            }
+        }
+    }
+
+    void print(std::ostream &os)const
+    {
+        print(os, 0, 0);
+        os << std::endl;
+    }
+
+private:
+    schema_field *find_field(size_t node, const std::string &name)
+    {
+        auto &fields=m_nodes[node].fields;
+        for(auto it=fields.begin(); it!=fields.end(); ++it){
+            if(it->name==name){
+                return &*it;
+            }
+        }
+        return 0;
+    }
+
+    // m_nodes may grow. hold indices, not references.
+    size_t get_field(size_t node, const std::string &name)
+    {
+        auto found=find_field(node, name);
+        if(found){
+            return found->node;
+        }
+        auto child=m_nodes.size();
+        m_nodes.push_back(schema_node());
+        m_nodes[node].fields.push_back(schema_field(name, child));
+        return child;
+    }
+
+    size_t get_items(size_t node)
+    {
+        if(m_nodes[node].items==schema_node::no_node){
+            auto child=m_nodes.size();
+            m_nodes.push_back(schema_node());
+            m_nodes[node].items=child;
+        }
+        return m_nodes[node].items;
+    }
+
+    void add_value(size_t index, unpacker &u)
+    {
+        auto head_byte=*u.range().get_current();
+        {
+            auto &n=m_nodes[index];
+            ++n.count;
+
+            if(u.is_nil()){
+                ++n.type_counts[schema_nil];
+                u.skip();
+                return;
+            }
+            if(u.is_bool()){
+                ++n.type_counts[schema_bool];
+                u.skip();
+                return;
+            }
+            if(u.is_integer()){
+                ++n.type_counts[schema_int];
+                if(head_byte==uint64_tag::bits){
+                    unsigned long long v;
+                    u >> v;
+                    n.add_int(v>static_cast<unsigned long long>(std::numeric_limits<long long>::max())
+                            ? std::numeric_limits<long long>::max()
+                            : static_cast<long long>(v));
+                }
+                else{
+                    long long v;
+                    u >> v;
+                    n.add_int(v);
+                }
+                return;
+            }
+            if(u.is_float()){
+                ++n.type_counts[schema_float];
+                double v;
+                u >> v;
+                n.add_float(v);
+                return;
+            }
+            if(u.is_str() || u.is_bin()){
+                ++n.type_counts[u.is_str() ? schema_str : schema_bin];
+                immutable_range r;
+                auto buffer=create_view_buffer(r);
+                u.unpack(buffer);
+                n.add_len(r.size());
+                return;
+            }
+            if(u.is_ext()){
+                ++n.type_counts[schema_ext];
+                u.skip();
+                return;
+            }
+        }
+
+        if(u.is_array()){
+            auto c=array();
+            u >> c;
+            auto &n=m_nodes[index];
+            ++n.type_counts[schema_array];
+            ++n.array_lengths[schema_node::length_bucket(c.size)];
+            if(c.size){
+                get_items(index);
+                m_stack.push_back(frame(index, c.size, false));
+            }
+            return;
+        }
+
+        if(u.is_map()){
+            auto c=map();
+            u >> c;
+            ++m_nodes[index].type_counts[schema_map];
+            m_stack.push_back(frame(index, c.size, true));
+            return;
+        }
+
+        throw invalid_head_byte(__FUNCTION__);
+    }
+
+    static void merge_node(schema_node &dst, const schema_node &src)
+    {
+        dst.count+=src.count;
+        for(int i=0; i<schema_type_count; ++i){
+            dst.type_counts[i]+=src.type_counts[i];
+        }
+        dst.min_len=std::min(dst.min_len, src.min_len);
+        dst.max_len=std::max(dst.max_len, src.max_len);
+        dst.min_int=std::min(dst.min_int, src.min_int);
+        dst.max_int=std::max(dst.max_int, src.max_int);
+        dst.min_float=std::min(dst.min_float, src.min_float);
+        dst.max_float=std::max(dst.max_float, src.max_float);
+        for(int i=0; i<schema_node::histogram_size; ++i){
+            dst.array_lengths[i]+=src.array_lengths[i];
+        }
+    }
+
+    void print(std::ostream &os, size_t index, int indent)const
+    {
+        auto &n=m_nodes[index];
+        bool first=true;
+        for(int i=0; i<schema_type_count; ++i){
+            if(!n.type_counts[i]){
+                continue;
+            }
+            if(!first){
+                os << "|";
+            }
+            first=false;
+
+            auto t=static_cast<schema_type_t>(i);
+            switch(t)
+            {
+                case schema_int:
+                    os << "int(" << n.min_int << ".." << n.max_int << ")";
+                    break;
+
+                case schema_float:
+                    os << "float(" << n.min_float << ".." << n.max_float << ")";
+                    break;
+
+                case schema_str:
+                case schema_bin:
+                    os << schema_type_name(t) << "(" << n.min_len << ".." << n.max_len << ")";
+                    break;
+
+                case schema_array:
+                    os << "[";
+                    if(n.items!=schema_node::no_node){
+                        print(os, n.items, indent);
+                    }
+                    os << "]{";
+                    {
+                        bool first_bucket=true;
+                        for(int k=0; k<schema_node::histogram_size; ++k){
+                            if(!n.array_lengths[k]){
+                                continue;
+                            }
+                            if(!first_bucket){
+                                os << ",";
+                            }
+                            first_bucket=false;
+                            // lower bound of the bucket
+                            os << (k ? (static_cast<size_t>(1)<<(k-1)) : 0) << ":" << n.array_lengths[k];
+                        }
+                    }
+                    os << "}";
+                    break;
+
+                case schema_map:
+                    os << "{" << std::endl;
+                    for(auto it=n.fields.begin(); it!=n.fields.end(); ++it){
+                        os << std::string((indent+1)*2, ' ') << it->name;
+                        if(n.is_optional(*it)){
+                            os << "?";
+                        }
+                        os << ":";
+                        print(os, it->node, indent+1);
+                        os << std::endl;
+                    }
+                    os << std::string(indent*2, ' ') << "}";
+                    break;
+
+                default:
+                    os << schema_type_name(t);
+                    break;
+            }
+        }
+    }
+};
+
+
+/// a schema for each input in parallel, merged in input order
+inline schema infer_schema(thread_pool &pool, const std::vector<immutable_range> &inputs)
+{
+    std::vector<schema> partial(inputs.size());
+    parallel_for(pool, inputs.size(), inputs.size(), [&](size_t begin, size_t end){
+        for(size_t i=begin; i<end; ++i){
+            partial[i].add_stream(inputs[i]);
+        }
+    });
+
+    schema merged;
+    for(auto it=partial.begin(); it!=partial.end(); ++it){
+        merged.merge(*it);
+    }
+    return merged;
+}
+
+inline schema infer_schema(thread_pool &pool, const std::vector<std::string> &paths)
+{
+    std::vector<schema> partial(paths.size());
+    read_files(pool, paths, [&](size_t i, const immutable_range &packed){
+        partial[i].add_stream(packed);
+    });
+
+    schema merged;
+    for(auto it=partial.begin(); it!=partial.end(); ++it){
+        merged.merge(*it);
+    }
+    return merged;
+}
+
+
+} // namespace
+} // namespace
@@ -16,6 +16,7 @@ enum typecategory_t
     typecategory_byte_array,
     typecategory_string,
     typecategory_collection,
+    typecategory_ext,
 };
 
 inline typecategory_t typecategory(unsigned char b)
@@ -69,7 +70,6 @@ inline typecategory_t typecategory(unsigned char b)
         case map32_tag::bits:
             return typecategory_collection;
 
-            /*
         case ext8_tag::bits:
         case ext16_tag::bits:
         case ext32_tag::bits:
@@ -78,7 +78,7 @@ inline typecategory_t typecategory(unsigned char b)
         case fixext4_tag::bits:
         case fixext8_tag::bits:
         case fixext16_tag::bits:
-            */
+            return typecategory_ext;
     }
 
     return typecategory_unknown;
@@ -176,6 +176,9 @@ inline void typestruct(unpacker &u, std::ostream &os)
         else if(u.is_str()){
             os << "string";
         }
+        else if(u.is_ext()){
+            os << "ext";
+        }
         else{
             os << "unknown";
         }
@@ -1,5 +1,6 @@
 #pragma once
 #include "../writer.h"
+#include "../chunked_writer.h"
 #include "../msgpack.h"
 
 namespace refrange {
@@ -14,9 +15,7 @@ inline packer create_external_vector_packer(std::vector<unsigned char> &packed_b
     auto buffer=&packed_buffer;
     auto writer=[buffer](const unsigned char *p, size_t size)->size_t
     {
-        for(size_t i=0; i<size; ++i){
-            buffer->push_back(*p++);
-        }
+        buffer->insert(buffer->end(), p, p+size);
         return size;
     };
     auto pointer=[buffer]()->const unsigned char *{
@@ -33,9 +32,7 @@ inline packer create_vector_packer()
     auto buffer=std::make_shared<std::vector<unsigned char>>();
     auto writer=[buffer](const unsigned char *p, size_t size)->size_t
     {
-        for(size_t i=0; i<size; ++i){
-            buffer->push_back(*p++);
-        }
+        buffer->insert(buffer->end(), p, p+size);
         return size;
     };
     auto pointer=[buffer]()->const unsigned char *{
@@ -67,6 +64,25 @@ inline packer create_packer(const mutable_range &r)
     return packer(writer, pointer, size);
 }
 
+/// packs into the blocks of w. packer::pointer flattens them.
+inline packer create_chunked_packer(const std::shared_ptr<chunked_writer> &w)
+{
+    auto writer=[w](const unsigned char *p, size_t size)->size_t
+    {
+        return w->write(p, size);
+    };
+
+    auto pointer=[w]()->const unsigned char *{
+        return w->flatten().begin();
+    };
+
+    auto size=[w]()->size_t{
+        return w->size();
+    };
+
+    return packer(writer, pointer, size);
+}
+
 
 template<class Container>
 inline unpacker create_unpacker(Container &c)
@@ -1,12 +1,16 @@
 #pragma once
 #include <stdexcept>
 #include <list>
+#include <iterator>
+#include <stddef.h>
 #include <functional>
 #include <fstream>
 #include <vector>
 #include <algorithm>
 #include <assert.h>
+#include "search.h"
 #include "text.h"
+#include "text/number.h"
 
 
 namespace refrange {
@@ -23,6 +27,114 @@ template<class T>
    };
 
 
+template<typename T>
+class range;
+
+
+//////////////////////////////////////////////////////////////////////////////
+// lazy split
+//////////////////////////////////////////////////////////////////////////////
+// delimiters are functors that take a position. see text.h for the classes.
+template<typename T>
+struct char_delimiter
+{
+    char m_c;
+
+    char_delimiter(char c)
+        : m_c(c)
+    {}
+
+    bool operator()(T p)const{ return *p==m_c; }
+};
+
+
+/// yields the tokens between delimiters on demand. empty tokens are skipped.
+template<typename T, typename PRED>
+class token_iterator
+{
+    T m_begin;
+    T m_token_end;
+    T m_end;
+    PRED m_pred;
+
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef range<T> value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const range<T>* pointer;
+    typedef const range<T>& reference;
+
+    token_iterator(T begin, T end, const PRED &pred)
+        : m_begin(begin), m_token_end(begin), m_end(end), m_pred(pred)
+    {
+        next();
+    }
+
+    range<T> operator*()const{ return range<T>(m_begin, m_token_end); }
+
+    // a temporary that lives until the end of the full expression
+    struct arrow
+    {
+        range<T> m_token;
+        const range<T> *operator->()const{ return &m_token; }
+    };
+    arrow operator->()const
+    {
+        arrow a={ range<T>(m_begin, m_token_end) };
+        return a;
+    }
+
+    token_iterator &operator++()
+    {
+        m_begin=m_token_end;
+        next();
+        return *this;
+    }
+
+    token_iterator operator++(int)
+    {
+        auto tmp=*this;
+        ++*this;
+        return tmp;
+    }
+
+    bool operator==(const token_iterator &rhs)const{ return m_begin==rhs.m_begin; }
+    bool operator!=(const token_iterator &rhs)const{ return m_begin!=rhs.m_begin; }
+
+private:
+    void next()
+    {
+        while(m_begin!=m_end && m_pred(m_begin)){
+            ++m_begin;
+        }
+        m_token_end=m_begin;
+        while(m_token_end!=m_end && !m_pred(m_token_end)){
+            ++m_token_end;
+        }
+    }
+};
+
+
+template<typename T, typename PRED>
+class token_range
+{
+    T m_begin;
+    T m_end;
+    PRED m_pred;
+
+public:
+    typedef token_iterator<T, PRED> iterator;
+    typedef token_iterator<T, PRED> const_iterator;
+
+    token_range(T begin, T end, const PRED &pred)
+        : m_begin(begin), m_end(end), m_pred(pred)
+    {}
+
+    iterator begin()const{ return iterator(m_begin, m_end, m_pred); }
+    iterator end()const{ return iterator(m_end, m_end, m_pred); }
+};
+
+
 template<typename T>
 class range
 {
@@ -60,40 +172,30 @@ public:
         return std::string(m_begin, end); 
     }
 
+    /// leading spaces are skipped. stops at the end of the range.
+    /// 0 when it does not start with a number. see text/number.h
     int to_int()const
     {
-        bool is_negative=false;
-        int n = 0;
-        for (auto p = m_begin; p != m_end; ++p)
-        { 
-            if(text::is_digit(p)){
-                n = n * 10 + (*p-'0');
-            }
-            else{
-                if(n==0){
-                    if(*p=='-'){
-                        is_negative=true;
-                    }
-                    else{
-						break;
-                    }
-                }
-				else{
-					break;
-				}
-            }
-        }
-		return is_negative ? -n : n;
+        int n=0;
+        auto t=ltrim();
+        text::parse_int32((const char*)t.m_begin, (const char*)t.m_end, n);
+        return n;
     }
 
     double to_double()const
     {
-        return atof((const char*)m_begin);
+        double d=0;
+        auto t=ltrim();
+        text::parse_double((const char*)t.m_begin, (const char*)t.m_end, d);
+        return d;
     }
 
     float to_float()const
     {
-        return static_cast<float>(to_double());
+        float f=0;
+        auto t=ltrim();
+        text::parse_float((const char*)t.m_begin, (const char*)t.m_end, f);
+        return f;
     }
 
     bool operator==(const range<T> &s)const
@@ -140,32 +242,42 @@ public:
         return r==s.end();
     }
 
+    /// first c or end
+    T find_byte(unsigned char c)const
+    {
+        return m_begin+(refrange::find_byte(m_begin, m_end, c)-m_begin);
+    }
+
+    /// first needle or end
+    T find(const unsigned char *needle, size_t len)const
+    {
+        return m_begin+(find_bytes(m_begin, m_end, needle, len)-m_begin);
+    }
+
+    template<typename U>
+    T find(const range<U> &needle)const
+    {
+        return find(needle.begin(), needle.size());
+    }
+
+    /// '\0' terminated needle
     T find(T p)const
     {
-        for(auto it=m_begin; it!=m_end; ++it){
-            bool is_match=true;
-            auto k=p;
-            for(auto j=it; j!=m_end && *p!='\0'; ++j, ++k){
-                if(*j!=*k){
-                    is_match=false;
-                    break;
-                }
-            }
-            if(is_match){
-                return it;
-            }
-        }
-        return m_end;
+        return find(p, strlen((const char*)p));
     }
 
-	range<T> find_range_if(const pred &func)const
-	{
-		return find_range_if(func, m_begin);
-	}
+    /// the first run of positions that satisfy func.
+    /// PRED is a functor (text::space_class...) or a function pointer.
+    template<typename PRED>
+    range<T> find_range_if(const PRED &func)const
+    {
+        return find_range_if(func, m_begin);
+    }
 
-	range<T> find_range_if(const pred &func, T p)const
-	{
-		T begin = p;
+    template<typename PRED>
+    range<T> find_range_if(const PRED &func, T p)const
+    {
+        T begin = p;
         // find match
         for(; begin!=m_end; ++begin){
             if(func(begin)){
@@ -182,51 +294,54 @@ public:
                 break;
             }
         }
-        return immutable_range(begin, end);
+        return range<T>(begin, end);
     }
 
-    std::list<range<T>> split(char c)const
+    /// lazy split. no allocation.
+    token_range<T, char_delimiter<T>> tokens(char c)const
     {
-        auto delimiter=[c](T t)
-        {
-            return *t==c;
-        };
+        return token_range<T, char_delimiter<T>>(m_begin, m_end, char_delimiter<T>(c));
+    }
+
+    token_range<T, text::space_class> tokens()const
+    {
+        return token_range<T, text::space_class>(m_begin, m_end, text::space_class());
+    }
 
-        return split(delimiter);
+    template<typename PRED>
+    token_range<T, PRED> tokens(const PRED &func)const
+    {
+        return token_range<T, PRED>(m_begin, m_end, func);
+    }
+
+    std::list<range<T>> split(char c)const
+    {
+        return to_list(tokens(c));
     }
 
     std::list<range<T>> split()const
     {
-        return split(&text::is_space<T>);
+        return to_list(tokens());
     }
 
     std::list<range<T>> split(const pred &func)const
     {
-        std::list<range<T>> splited;
-        if(m_begin==m_end){
-            return splited;
-        }
+        return to_list(tokens(func));
+    }
 
-        auto begin=m_begin;
-        while(begin!=m_end){
-			auto range = find_range_if(std::not1(func), begin);
-            if(!range){
-                break;
-            }
-            splited.push_back(range);
-            begin=range.end();
-        }
-        return splited;
+    template<typename TOKENS>
+    static std::list<range<T>> to_list(const TOKENS &tokens)
+    {
+        return std::list<range<T>>(tokens.begin(), tokens.end());
     }
 
     range<T> ltrim()const
     {
-        auto range=find_range_if(&text::is_space<T>);
         auto begin=m_begin;
-        if(range && range.begin()==m_begin){
-            begin=range.end();
+        while(begin!=m_end && text::is_space(begin)){
+            ++begin;
         }
-        return immutable_range(begin, m_end);
+        return range<T>(begin, m_end);
     }
 };
 typedef range<const unsigned char*> immutable_range;
@@ -264,22 +379,50 @@ inline immutable_range vectorrange(const std::vector<unsigned char> &v)
 }
 
 
-inline std::vector<unsigned char> readfile(const char *path)
+/// chunks of about chunk_size that end after '\n' (or at the end)
+inline std::vector<immutable_range> split_lines(const immutable_range &src, size_t chunk_size)
 {
-    std::vector<unsigned char> buf;
+    std::vector<immutable_range> chunks;
+    auto p=src.begin();
+    auto end=src.end();
+    while(p<end){
+        if(static_cast<size_t>(end-p)<=chunk_size){
+            chunks.push_back(immutable_range(p, end));
+            break;
+        }
+        auto nl=find_byte(p+chunk_size-1, end, '\n');
+        auto chunk_end=nl<end ? nl+1 : end;
+        chunks.push_back(immutable_range(p, chunk_end));
+        p=chunk_end;
+    }
+    return chunks;
+}
+
+
+/// reuses the capacity of buf. false if it can not be opened.
+inline bool readfile(const char *path, std::vector<unsigned char> &buf)
+{
+    buf.clear();
     std::ifstream ifs(path, std::ios::binary);
     if(!ifs){
-        return buf;
+        return false;
     }
 
 	ifs.seekg (0, std::ios::end);
 	buf.resize((size_t)ifs.tellg());
     if(buf.empty()){
-        return buf;
+        return true;
     }
     ifs.seekg (0, std::ios::beg);
 	ifs.read ((char*)&buf[0], buf.size());
+    return true;
+}
+
 
+inline std::vector<unsigned char> readfile(const char *path)
+{
+    std::vector<unsigned char> buf;
+    readfile(path, buf);
     return std::move(buf);
 }
 
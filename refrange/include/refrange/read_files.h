@@ -0,0 +1,54 @@
+#pragma once
+#include "range.h"
+#include "thread_pool.h"
+#include <string>
+#include <vector>
+#include <mutex>
+
+
+namespace refrange {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// batched file loading
+//////////////////////////////////////////////////////////////////////////////
+// reads many files at once and calls f(index, immutable_range) for each one
+// as soon as it is read, while the other reads are still in flight.
+// f runs on the pool and has to be thread safe. the range is valid during the call.
+//
+// the reads are readfile on the pool workers, one buffer per chunk.
+
+namespace detail {
+
+    template<typename F>
+    inline std::vector<size_t> read_files_pool(thread_pool &pool, const std::vector<std::string> &paths, F &f)
+    {
+        std::mutex mutex;
+        std::vector<size_t> failed;
+        parallel_for(pool, paths.size(), 0, [&](size_t begin, size_t end){
+            std::vector<unsigned char> buf;
+            for(size_t i=begin; i<end; ++i){
+                if(!readfile(paths[i].c_str(), buf)){
+                    std::lock_guard<std::mutex> lock(mutex);
+                    failed.push_back(i);
+                    continue;
+                }
+                f(i, vectorrange(buf));
+            }
+        });
+        std::sort(failed.begin(), failed.end());
+        return failed;
+    }
+
+} // namespace
+
+
+/// returns the indices of the paths that could not be read
+template<typename F>
+inline std::vector<size_t> read_files(thread_pool &pool, const std::vector<std::string> &paths, F f)
+{
+    return detail::read_files_pool(pool, paths, f);
+}
+
+
+} // namespace
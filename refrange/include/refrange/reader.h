@@ -1,9 +1,72 @@
 #pragma once
 #include "range.h"
+#include <type_traits>
 
 
 namespace refrange {
 
+
+/// reads a span that range_reader::span validated up front.
+/// no bounds checks except asserts. for fixed size records in a loop.
+class unchecked_reader
+{
+    const unsigned char *m_current;
+    const unsigned char *m_end;
+
+public:
+    unchecked_reader(const unsigned char *begin, const unsigned char *end)
+        : m_current(begin), m_end(end)
+    {}
+
+    const unsigned char *get_current()const{ return m_current; }
+    size_t remain_size()const{ return m_end-m_current; }
+
+    template<typename T>
+        void read_value(T &t)
+        {
+            assert(m_current+sizeof(T)<=m_end);
+            memcpy(&t, m_current, sizeof(T));
+            m_current+=sizeof(T);
+        }
+
+    template<typename T>
+        T read()
+        {
+            T t;
+            read_value(t);
+            return t;
+        }
+
+    template<typename T>
+        void read_array(T *p, size_t count)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "memcpy");
+            assert(m_current+sizeof(T)*count<=m_end);
+            memcpy(p, m_current, sizeof(T)*count);
+            m_current+=sizeof(T)*count;
+        }
+
+    immutable_range read_range(size_t bytes)
+    {
+        assert(m_current+bytes<=m_end);
+        immutable_range r(m_current, m_current+bytes);
+        m_current+=bytes;
+        return r;
+    }
+
+    std::string read_str(size_t bytes)
+    {
+        return read_range(bytes).to_str();
+    }
+
+    void skip(size_t bytes)
+    {
+        assert(m_current+bytes<=m_end);
+        m_current+=bytes;
+    }
+};
+
+
 class range_reader
 {
     immutable_range m_range;
@@ -56,6 +119,34 @@ public:
         read_range(bytes);
     }
 
+    /// count records of stride bytes. one bounds check for all of them.
+    unchecked_reader span(size_t count, size_t stride=1)
+    {
+        if(stride && count>remain_size()/stride){
+            throw std::range_error(__FUNCTION__);
+        }
+        auto r=read_range(count*stride);
+        return unchecked_reader(r.begin(), r.end());
+    }
+
+    /// packed POD array. one bounds check and one memcpy.
+    template<typename T>
+        void read_array(T *p, size_t count)
+        {
+            span(count, sizeof(T)).read_array(p, count);
+        }
+
+    template<typename T>
+        std::vector<T> read_array(size_t count)
+        {
+            auto cursor=span(count, sizeof(T));
+            std::vector<T> v(count);
+            if(count){
+                cursor.read_array(&v[0], count);
+            }
+            return v;
+        }
+
     std::string read_str(size_t bytes)
     {
         auto r=read_range(bytes);
@@ -95,14 +186,10 @@ public:
         return len;
     }
 
+    /// moves to the first c or the end
     const unsigned char* find(unsigned char c)
     {    
-		auto e = m_range.end();
-        for(; m_current!=e; ++m_current){
-            if(*m_current==c){
-                break;
-            }
-        }
+        m_current=find_byte(m_current, m_range.end(), c);
         return m_current;
     }
 
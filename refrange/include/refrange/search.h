@@ -0,0 +1,90 @@
+#pragma once
+#include <string.h>
+#include "simd.h"
+
+
+namespace refrange {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// byte and substring search
+//////////////////////////////////////////////////////////////////////////////
+/// first c in [p, end) or end
+inline const unsigned char *find_byte(const unsigned char *p, const unsigned char *end, unsigned char c)
+{
+    if(p>=end){
+        return end;
+    }
+    auto found=memchr(p, c, end-p);
+    return found ? static_cast<const unsigned char*>(found) : end;
+}
+
+/// first needle in [p, end) or end. an empty needle is found at p.
+///
+/// the vector path compares the first and the last byte of the needle at
+/// 16 or 32 positions at once and verifies only the candidates (SIMD prefilter).
+/// the rest jumps between the first bytes with memchr.
+inline const unsigned char *find_bytes(const unsigned char *p, const unsigned char *end,
+        const unsigned char *needle, size_t len)
+{
+    if(len==0){
+        return p;
+    }
+    if(len==1){
+        return find_byte(p, end, needle[0]);
+    }
+    if(p>=end || static_cast<size_t>(end-p)<len){
+        return end;
+    }
+    // the last position a match can start
+    auto last=end-len;
+
+#if defined(REFRANGE_SIMD_AVX2)
+    const __m256i first_byte=_mm256_set1_epi8(static_cast<char>(needle[0]));
+    const __m256i last_byte=_mm256_set1_epi8(static_cast<char>(needle[len-1]));
+    for(; last-p>=31; p+=32){
+        auto head=_mm256_loadu_si256((const __m256i*)p);
+        auto tail=_mm256_loadu_si256((const __m256i*)(p+len-1));
+        auto mask=static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(
+                        _mm256_cmpeq_epi8(head, first_byte), _mm256_cmpeq_epi8(tail, last_byte))));
+        while(mask){
+            auto i=simd::trailing_zeros(mask);
+            if(memcmp(p+i+1, needle+1, len-2)==0){
+                return p+i;
+            }
+            mask&=mask-1;
+        }
+    }
+#elif defined(REFRANGE_SIMD_SSE2)
+    const __m128i first_byte=_mm_set1_epi8(static_cast<char>(needle[0]));
+    const __m128i last_byte=_mm_set1_epi8(static_cast<char>(needle[len-1]));
+    for(; last-p>=15; p+=16){
+        auto head=_mm_loadu_si128((const __m128i*)p);
+        auto tail=_mm_loadu_si128((const __m128i*)(p+len-1));
+        auto mask=static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(
+                        _mm_cmpeq_epi8(head, first_byte), _mm_cmpeq_epi8(tail, last_byte))));
+        while(mask){
+            auto i=simd::trailing_zeros(mask);
+            if(memcmp(p+i+1, needle+1, len-2)==0){
+                return p+i;
+            }
+            mask&=mask-1;
+        }
+    }
+#endif
+
+    while(p<=last){
+        p=static_cast<const unsigned char*>(memchr(p, needle[0], last-p+1));
+        if(!p){
+            return end;
+        }
+        if(memcmp(p+1, needle+1, len-1)==0){
+            return p;
+        }
+        ++p;
+    }
+    return end;
+}
+
+
+} // namespace
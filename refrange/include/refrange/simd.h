@@ -0,0 +1,47 @@
+#pragma once
+//
+// SIMD selection at compile time.
+// REFRANGE_SIMD_AVX2 or REFRANGE_SIMD_SSE2 is defined for the target.
+// REFRANGE_NO_SIMD forces the scalar paths.
+//
+#if !defined(REFRANGE_NO_SIMD)
+#if defined(__AVX2__)
+#define REFRANGE_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define REFRANGE_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace refrange {
+namespace simd {
+
+
+/// bits must not be 0
+inline unsigned int trailing_zeros(unsigned long long bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if(_BitScanForward(&index, static_cast<unsigned long>(bits))){
+        return index;
+    }
+    _BitScanForward(&index, static_cast<unsigned long>(bits>>32));
+    return index+32;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+
+} // namespace
+} // namespace
@@ -1,26 +1,89 @@
 #pragma once
-#include <ctype.h>
-#include "range.h"
 
 
 namespace refrange {
 namespace text {
 
 
+//////////////////////////////////////////////////////////////////////////////
+// ascii character classes
+//////////////////////////////////////////////////////////////////////////////
+// table driven. independent of the locale (isspace, isdigit).
+enum char_class_t
+{
+    char_space=1,
+    char_digit=2,
+    char_alpha=4,
+};
+
+inline bool is_class(unsigned char c, int mask)
+{
+    // 1: " \t\n\v\f\r", 2: "0-9", 4: "A-Za-z". non ascii is 0.
+    static const unsigned char table[256]={
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0,
+        0, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+        4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0,
+        0, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+        4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0, 0, 0, 0, 0,
+    };
+    return (table[c] & mask)!=0;
+}
+
+
 template<typename T>
 inline bool is_space(T p)
 {
-    return isspace(*p) != 0;
+    return is_class(static_cast<unsigned char>(*p), char_space);
 }
 
 
 template<typename T>
 inline bool is_digit(T *p)
 {
-    return isdigit(*p) != 0;
+    return is_class(static_cast<unsigned char>(*p), char_digit);
+}
+
+
+template<typename T>
+inline bool is_alpha(T p)
+{
+    return is_class(static_cast<unsigned char>(*p), char_alpha);
 }
 
 
+/// predicates for range::find_range_if and range::tokens. inlined unlike a function pointer.
+template<int MASK>
+struct char_class
+{
+    template<typename T>
+    bool operator()(T p)const{ return is_class(static_cast<unsigned char>(*p), MASK); }
+};
+typedef char_class<char_space> space_class;
+typedef char_class<char_digit> digit_class;
+typedef char_class<char_alpha> alpha_class;
+typedef char_class<char_alpha | char_digit> alnum_class;
+
+
+template<typename PRED>
+struct not_class
+{
+    PRED m_pred;
+
+    not_class(const PRED &pred=PRED())
+        : m_pred(pred)
+    {}
+
+    template<typename T>
+    bool operator()(T p)const{ return !m_pred(p); }
+};
+
 
 } // namespace
 } // namespace
+
+
+// range.h uses the classes above
+#include "range.h"
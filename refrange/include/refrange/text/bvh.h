@@ -1,7 +1,9 @@
 #pragma once
 #include "text_reader.h"
 #include "../tree.h"
+#include "../thread_pool.h"
 #include <memory>
+#include <functional>
 #include <array>
 #include <string>
 
@@ -66,9 +68,69 @@ struct joint
 };
 
 
-struct frame
+/// a view of every stride-th value. a column of the motion.
+template<typename T>
+class strided_range
 {
-    std::vector<float> values;
+    T *m_begin;
+    size_t m_size;
+    size_t m_stride;
+
+public:
+    strided_range(T *begin, size_t size, size_t stride)
+        : m_begin(begin), m_size(size), m_stride(stride)
+    {}
+
+    size_t size()const{ return m_size; }
+    size_t stride()const{ return m_stride; }
+    T &operator[](size_t i)const{ return m_begin[i*m_stride]; }
+};
+
+
+/// frames x channels in one row major block.
+/// a row is one frame, a column is one channel over all frames.
+class motion
+{
+    size_t m_frames;
+    size_t m_channels;
+    float m_frame_time;
+    std::vector<float> m_values;
+
+public:
+    motion()
+        : m_frames(0), m_channels(0), m_frame_time(0)
+    {}
+
+    void resize(size_t frames, size_t channels)
+    {
+        m_frames=frames;
+        m_channels=channels;
+        m_values.assign(frames*channels, 0);
+    }
+
+    size_t frame_count()const{ return m_frames; }
+    size_t channel_count()const{ return m_channels; }
+    float frame_time()const{ return m_frame_time; }
+    void set_frame_time(float frame_time){ m_frame_time=frame_time; }
+
+    /// channel_count values
+    float *row(size_t frame){ return m_values.data()+frame*m_channels; }
+    const float *row(size_t frame)const{ return m_values.data()+frame*m_channels; }
+
+    /// frame_count values with the stride channel_count
+    strided_range<float> column(size_t channel)
+    {
+        return strided_range<float>(m_values.data()+channel, m_frames, m_channels);
+    }
+    strided_range<const float> column(size_t channel)const
+    {
+        return strided_range<const float>(m_values.data()+channel, m_frames, m_channels);
+    }
+
+    float &at(size_t frame, size_t channel){ return m_values[frame*m_channels+channel]; }
+    float at(size_t frame, size_t channel)const{ return m_values[frame*m_channels+channel]; }
+
+    const std::vector<float> &values()const{ return m_values; }
 };
 
 
@@ -79,38 +141,86 @@ class loader
 {
     std::vector<joint> m_joints;
     hierarchy m_hierarchy;
-    std::vector<frame> m_frames;
+    // the same joints. index==joint index
+    flat_hierarchy m_flat_hierarchy;
+    motion m_motion;
+    // the first channel of each joint and the total at the back
+    std::vector<size_t> m_channel_offsets;
+    // the joint of each channel
+    std::vector<size_t> m_channel_joints;
 
 public:
     std::vector<joint> &get_joints(){ return m_joints; }
+    const std::vector<joint> &get_joints()const{ return m_joints; }
     hierarchy &get_hierarchy(){ return m_hierarchy; }
-    std::vector<frame> &get_frames(){ return m_frames; }
-    size_t get_channel_count()const{
-        size_t channels=0;
-        for(auto it=m_joints.begin(); it!=m_joints.end(); ++it){
-            channels+=it->channels.size();
+    flat_hierarchy &get_flat_hierarchy(){ return m_flat_hierarchy; }
+    const flat_hierarchy &get_flat_hierarchy()const{ return m_flat_hierarchy; }
+    motion &get_motion(){ return m_motion; }
+    size_t get_channel_count()const{ return m_channel_joints.size(); }
+    /// the columns of joint are [get_channel_offset(joint), get_channel_offset(joint+1))
+    size_t get_channel_offset(size_t joint)const{ return m_channel_offsets[joint]; }
+    size_t get_channel_joint(size_t channel)const{ return m_channel_joints[channel]; }
+
+    bool load(const immutable_range &r)
+    {
+        line_reader reader(r);
+        if(!parse_hierarchy(reader)){
+            return false;
         }
-        return channels;
+        if(!parse_frames(reader, 0)){
+            return false;
+        }
+        return true;
     }
 
-    bool load(const immutable_range &r)
+    /// the MOTION lines are parsed on pool
+    bool load(const immutable_range &r, thread_pool &pool)
     {
         line_reader reader(r);
         if(!parse_hierarchy(reader)){
             return false;
         }
-        if(!parse_frames(reader)){
+        if(!parse_frames(reader, &pool)){
             return false;
         }
         return true;
     }
 
+    /// HIERARCHY and the MOTION header without the frame lines.
+    /// returns the first frame line or 0. the motion stays empty.
+    const unsigned char *load_header(const immutable_range &r, size_t &frames)
+    {
+        line_reader reader(r);
+        if(!parse_hierarchy(reader)){
+            return 0;
+        }
+        if(!parse_motion_header(reader, frames)){
+            return 0;
+        }
+        return reader.get_current();
+    }
+
+    /// false unless the line has exactly channel_count values
+    static bool parse_row(const immutable_range &line, float *row, size_t channels)
+    {
+        size_t c=0;
+        auto tokens=line.tokens();
+        for(auto it=tokens.begin(); it!=tokens.end(); ++it, ++c){
+            if(c==channels){
+                return false;
+            }
+            row[c]=it->to_float();
+        }
+        return c==channels;
+    }
+
+
 private:
 
     void assign_offset(joint &j, const immutable_range &r)
     {
-        auto splited=r.split();
-        auto it=splited.begin();
+        auto tokens=r.tokens();
+        auto it=tokens.begin();
         assert(it->to_str()=="OFFSET");
         ++it;
         j.offset.x=it->to_float();
@@ -125,8 +235,8 @@ private:
 		j.ends.push_back(vec3());
         auto &end=j.ends.back();
 
-        auto splited=r.split();
-        auto it=splited.begin();
+        auto tokens=r.tokens();
+        auto it=tokens.begin();
         assert(it->to_str()=="OFFSET");
         ++it;
         end.x=it->to_float();
@@ -138,8 +248,8 @@ private:
 
     void assign_channel(joint &j, const immutable_range &r)
     {
-        auto splited=r.split();
-        auto it=splited.begin();
+        auto tokens=r.tokens();
+        auto it=tokens.begin();
         assert(it->to_str()=="CHANNELS");
         ++it;
         auto channels=it->to_int();
@@ -185,8 +295,8 @@ private:
                 break;
             }
 
-            auto splited=root_line.split();
-            auto it=splited.begin();
+            auto tokens=root_line.tokens();
+            auto it=tokens.begin();
             auto key=it->to_str();
             if(key=="JOINT"){
 				size_t index = m_joints.size();
@@ -199,8 +309,11 @@ private:
                 auto open_line=reader.get_line().ltrim();
                 assert(open_line=="{");
 
+				m_flat_hierarchy.add(static_cast<int>(parent->value), pJoint->name);
+
 				parent->children.push_back(hierarchy());
 				parent->children.back().value=index;
+				parent->children.back().parent=parent;
 				parse_joint(reader, &parent->children.back());
             }
             else if(key=="End"){
@@ -234,31 +347,87 @@ private:
 		m_joints.push_back(joint());
 		m_hierarchy.value = 0;
 
-        auto root_line=reader.get_line().ltrim().split();
+        auto root_line=reader.get_line().ltrim().tokens();
 		auto it = root_line.begin();
 		assert(*it == "ROOT");
 		++it;
         m_joints[0].name=it->to_str();
+        m_flat_hierarchy.add(flat_hierarchy::none, m_joints[0].name);
 
         auto open_line=reader.get_line().ltrim();
         assert(open_line=="{");
         if(!parse_joint(reader, &m_hierarchy)){
             return false;
         }
+        m_flat_hierarchy.finalize();
 
         return true;
     }
 
-    bool parse_frames(line_reader &reader)
+    void build_channel_table()
+    {
+        m_channel_offsets.clear();
+        m_channel_joints.clear();
+        for(size_t i=0; i<m_joints.size(); ++i){
+            m_channel_offsets.push_back(m_channel_joints.size());
+            m_channel_joints.insert(m_channel_joints.end(), m_joints[i].channels.size(), i);
+        }
+        m_channel_offsets.push_back(m_channel_joints.size());
+    }
+
+    /// line aligned chunks of the MOTION lines. each chunk counts its lines,
+    /// then parses them into its rows of the matrix.
+    bool parse_rows(thread_pool &pool, const immutable_range &src)
+    {
+        enum { min_chunk_size=64*1024 };
+        auto frames=m_motion.frame_count();
+        auto channels=m_motion.channel_count();
+        auto chunk_size=std::max<size_t>(min_chunk_size, src.size()/(pool.size()*4));
+        auto chunks=split_lines(src, chunk_size);
+
+        // empty lines do not count
+        std::vector<size_t> first_rows(chunks.size()+1);
+        parallel_for(pool, chunks.size(), chunks.size(), [&](size_t begin, size_t end){
+            for(size_t i=begin; i<end; ++i){
+                line_reader lines(chunks[i]);
+                size_t count=0;
+                while(lines.get_line()){
+                    ++count;
+                }
+                first_rows[i+1]=count;
+            }
+        });
+        for(size_t i=0; i<chunks.size(); ++i){
+            first_rows[i+1]+=first_rows[i];
+        }
+        if(first_rows.back()<frames){
+            return false;
+        }
+
+        std::vector<char> ok(chunks.size(), 1);
+        parallel_for(pool, chunks.size(), chunks.size(), [&](size_t begin, size_t end){
+            for(size_t i=begin; i<end; ++i){
+                line_reader lines(chunks[i]);
+                for(auto frame=first_rows[i]; frame<first_rows[i+1] && frame<frames; ++frame){
+                    if(!parse_row(lines.get_line(), m_motion.row(frame), channels)){
+                        ok[i]=0;
+                        break;
+                    }
+                }
+            }
+        });
+        return std::find(ok.begin(), ok.end(), 0)==ok.end();
+    }
+
+    bool parse_motion_header(line_reader &reader, size_t &frames)
     {
         if(reader.get_line()!="MOTION"){
             return false;
         }
-        size_t frames=0;
         {
             auto line=reader.get_line();
-			auto splited = line.split(':');
-			auto it = splited.begin();
+			auto tokens = line.tokens(':');
+			auto it = tokens.begin();
             if(*it!="Frames"){
                 return false;
             }
@@ -270,27 +439,170 @@ private:
             if(!line.startswith("Frame Time:")){
                 return false;
             }
+            m_motion.set_frame_time(immutable_range(line.begin()+11, line.end()).to_float());
         }
 
-		auto channels = 0;
-		for (auto it = m_joints.begin(); it != m_joints.end(); ++it){
-			channels += it->channels.size();
-		}
+        build_channel_table();
+        return true;
+    }
 
-        m_frames.resize(frames);
+    bool parse_frames(line_reader &reader, thread_pool *pool)
+    {
+        size_t frames=0;
+        if(!parse_motion_header(reader, frames)){
+            return false;
+        }
+        auto channels=get_channel_count();
+        m_motion.resize(frames, channels);
+        if(pool){
+            return parse_rows(*pool, immutable_range(reader.get_current(), reader.get_range().end()));
+        }
         for(size_t i=0; i<frames; ++i){
-            auto &frame=m_frames[i];
-            auto splited=reader.get_line().split();
-			//assert(splited.size() == channels);
-			for (auto it = splited.begin(); it != splited.end(); ++it)
-            {
-                frame.values.push_back(it->to_float());
+            if(!parse_row(reader.get_line(), m_motion.row(i), channels)){
+                return false;
             }
         }
         return true;
     }
 };
 
+
+//////////////////////////////////////////////////////////////////////////////
+// streaming
+//////////////////////////////////////////////////////////////////////////////
+/// fills p up to size. 0 at the end.
+typedef std::function<size_t(unsigned char *p, size_t size)> reader_t;
+
+enum { default_chunk_size=64*1024 };
+
+
+/// parses the HIERARCHY once, then the frames batch by batch.
+/// holds a window of about chunk_size bytes and one batch, not the file.
+class stream_reader
+{
+    reader_t m_reader;
+    std::vector<unsigned char> m_buffer;
+    // unread bytes are [m_begin, m_used)
+    size_t m_begin;
+    size_t m_used;
+    bool m_eof;
+    loader m_header;
+    size_t m_frames;
+    size_t m_read_frames;
+
+public:
+    stream_reader(const reader_t &reader, size_t chunk_size=default_chunk_size)
+        : m_reader(reader), m_buffer(std::max<size_t>(chunk_size, 1)), m_begin(0), m_used(0), m_eof(false)
+          , m_frames(0), m_read_frames(0)
+    {}
+
+    /// the joints, the hierarchies and the channel table. the motion is empty.
+    loader &get_header(){ return m_header; }
+    /// the Frames line
+    size_t get_frame_count()const{ return m_frames; }
+    size_t get_read_frame_count()const{ return m_read_frames; }
+    float get_frame_time(){ return m_header.get_motion().frame_time(); }
+
+    /// reads up to the first frame line
+    bool open()
+    {
+        static const char key[]="Frame Time:";
+        while(true){
+            // the header ends at the line break after the key
+            auto window=immutable_range(&m_buffer[0], &m_buffer[0]+m_used);
+            auto found=window.find((const unsigned char*)key, sizeof(key)-1);
+            if(found<window.end()){
+                auto nl=find_byte(found, window.end(), '\n');
+                if(nl<window.end() || m_eof){
+                    size_t frames=0;
+                    auto end=nl<window.end() ? nl+1 : nl;
+                    auto first=m_header.load_header(immutable_range(window.begin(), end), frames);
+                    if(!first){
+                        return false;
+                    }
+                    m_frames=frames;
+                    m_begin=first-window.begin();
+                    return true;
+                }
+            }
+            if(m_eof){
+                return false;
+            }
+            fill();
+        }
+    }
+
+    /// up to max_frames rows into batch (frames x channels). 0 at the end.
+    /// throws std::invalid_argument for a line without the channel count.
+    size_t read(motion &batch, size_t max_frames)
+    {
+        auto channels=m_header.get_channel_count();
+        auto n=std::min(max_frames, m_frames-m_read_frames);
+        if(batch.frame_count()!=n || batch.channel_count()!=channels){
+            batch.resize(n, channels);
+        }
+        batch.set_frame_time(get_frame_time());
+
+        size_t count=0;
+        for(; count<n; ++count){
+            auto line=next_line();
+            if(!line){
+                // fewer lines than the Frames line
+                batch.resize(count, channels);
+                break;
+            }
+            if(!loader::parse_row(line, batch.row(count), channels)){
+                throw std::invalid_argument(__FUNCTION__);
+            }
+        }
+        m_read_frames+=count;
+        return count;
+    }
+
+private:
+    /// the next non empty line. empty at the end.
+    immutable_range next_line()
+    {
+        while(true){
+            auto begin=&m_buffer[0]+m_begin;
+            auto end=&m_buffer[0]+m_used;
+            auto nl=find_byte(begin, end, '\n');
+            if(nl<end || (m_eof && begin<end)){
+                m_begin=(nl<end ? nl+1 : end)-&m_buffer[0];
+                auto line=immutable_range(begin, nl);
+                if(!line.ltrim()){
+                    // empty line
+                    continue;
+                }
+                return line;
+            }
+            if(m_eof){
+                return immutable_range();
+            }
+            fill();
+        }
+    }
+
+    /// moves the unread bytes to the front and reads after them.
+    /// the window grows only for a line (or a header) longer than it.
+    void fill()
+    {
+        if(m_begin>0){
+            memmove(&m_buffer[0], &m_buffer[0]+m_begin, m_used-m_begin);
+            m_used-=m_begin;
+            m_begin=0;
+        }
+        if(m_used==m_buffer.size()){
+            m_buffer.resize(m_buffer.size()*2);
+        }
+        auto n=m_reader(&m_buffer[0]+m_used, m_buffer.size()-m_used);
+        if(n==0){
+            m_eof=true;
+        }
+        m_used+=n;
+    }
+};
+
 } // namespace
 } // namespace
 } // namespace
@@ -0,0 +1,282 @@
+#pragma once
+#include "bvh.h"
+#include "../thread_pool.h"
+#include <math.h>
+#include <algorithm>
+
+
+namespace refrange {
+namespace text {
+namespace bvh {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// forward kinematics
+//////////////////////////////////////////////////////////////////////////////
+// world = parent world * translate(offset + position channels) * rotations
+// with the rotations composed in the channel order (ZXY, XYZ...). degrees.
+//
+// structure of arrays across frames: every joint is evaluated for a block of
+// frames at once with plain loops over the frames, which the compiler vectorizes.
+
+
+/// world transforms of frames x joints. one array per component,
+/// indexed by joint*frame_count+frame so that a joint is contiguous over frames.
+class world_poses
+{
+    size_t m_frames;
+    size_t m_joints;
+
+public:
+    std::vector<float> px;
+    std::vector<float> py;
+    std::vector<float> pz;
+    // the rotation matrix. r[row*3+col]
+    std::vector<float> r[9];
+
+    world_poses()
+        : m_frames(0), m_joints(0)
+    {}
+
+    void resize(size_t frames, size_t joints)
+    {
+        m_frames=frames;
+        m_joints=joints;
+        px.resize(frames*joints);
+        py.resize(frames*joints);
+        pz.resize(frames*joints);
+        for(int i=0; i<9; ++i){
+            r[i].resize(frames*joints);
+        }
+    }
+
+    size_t frame_count()const{ return m_frames; }
+    size_t joint_count()const{ return m_joints; }
+    size_t index(size_t frame, size_t joint)const{ return joint*m_frames+frame; }
+
+    vec3 position(size_t frame, size_t joint)const
+    {
+        auto i=index(frame, joint);
+        vec3 v={ px[i], py[i], pz[i] };
+        return v;
+    }
+};
+
+
+class fk_evaluator
+{
+    struct plan
+    {
+        int joint;
+        // -1 for a root
+        int parent;
+        vec3 offset;
+        // the columns of the position channels. -1 if none
+        int position[3];
+        // the columns and the axes (0: x, 1: y, 2: z) in the channel order
+        int rotation[3];
+        int axis[3];
+        int rotation_count;
+    };
+    // parent before child
+    std::vector<plan> m_plans;
+    size_t m_channels;
+
+public:
+    enum { block_frames=256 };
+
+    fk_evaluator(const loader &l)
+        : m_channels(l.get_channel_count())
+    {
+        auto &hierarchy=l.get_flat_hierarchy();
+        auto &order=hierarchy.order();
+        if(order.size()!=hierarchy.size()){
+            // not finalized
+            throw std::invalid_argument(__FUNCTION__);
+        }
+        for(auto it=order.begin(); it!=order.end(); ++it){
+            auto &j=l.get_joints()[*it];
+            plan p;
+            p.joint=*it;
+            p.parent=hierarchy.parent(*it);
+            p.offset=j.offset;
+            p.position[0]=p.position[1]=p.position[2]=-1;
+            p.rotation_count=0;
+            auto column=static_cast<int>(l.get_channel_offset(*it));
+            for(auto c=j.channels.begin(); c!=j.channels.end(); ++c, ++column){
+                switch(*c)
+                {
+                    case channel_Xposition: p.position[0]=column; break;
+                    case channel_Yposition: p.position[1]=column; break;
+                    case channel_Zposition: p.position[2]=column; break;
+                    case channel_Xrotation:
+                    case channel_Yrotation:
+                    case channel_Zrotation:
+                        if(p.rotation_count==3){
+                            throw std::invalid_argument(__FUNCTION__);
+                        }
+                        p.rotation[p.rotation_count]=column;
+                        p.axis[p.rotation_count]=*c-channel_Xrotation;
+                        ++p.rotation_count;
+                        break;
+                    default:
+                        throw std::invalid_argument(__FUNCTION__);
+                }
+            }
+            m_plans.push_back(p);
+        }
+    }
+
+    size_t joint_count()const{ return m_plans.size(); }
+
+    /// frames [begin, end) of m into out. out has end-begin frames
+    /// and the joints in the loader order.
+    void evaluate(const motion &m, size_t begin, size_t end, world_poses &out)const
+    {
+        if(m.channel_count()!=m_channels || end<begin || end>m.frame_count()){
+            throw std::invalid_argument(__FUNCTION__);
+        }
+        out.resize(end-begin, m_plans.size());
+        evaluate_range(m, begin, 0, end-begin, out);
+    }
+
+    /// blocks of frames on pool
+    void evaluate(thread_pool &pool, const motion &m, size_t begin, size_t end, world_poses &out)const
+    {
+        if(m.channel_count()!=m_channels || end<begin || end>m.frame_count()){
+            throw std::invalid_argument(__FUNCTION__);
+        }
+        out.resize(end-begin, m_plans.size());
+        auto blocks=(end-begin+block_frames-1)/block_frames;
+        parallel_for(pool, blocks, 0, [&](size_t first, size_t last){
+            auto out_begin=first*block_frames;
+            auto out_end=std::min(end-begin, last*block_frames);
+            evaluate_range(m, begin+out_begin, out_begin, out_end, out);
+        });
+    }
+
+private:
+    /// out frames [out_begin, out_end) from the frames at m_begin
+    void evaluate_range(const motion &m, size_t m_begin, size_t out_begin, size_t out_end, world_poses &out)const
+    {
+        const auto frames=out.frame_count();
+        float local[9][block_frames];
+        float t[3][block_frames];
+        float cos_a[block_frames];
+        float sin_a[block_frames];
+        const float to_radian=3.14159265358979f/180.0f;
+
+        for(size_t block=out_begin; block<out_end; block+=block_frames){
+            const int n=static_cast<int>(std::min<size_t>(block_frames, out_end-block));
+            auto first_frame=m_begin+(block-out_begin);
+
+            for(auto it=m_plans.begin(); it!=m_plans.end(); ++it){
+                auto &p=*it;
+
+                // local translation
+                const float offset[3]={ p.offset.x, p.offset.y, p.offset.z };
+                for(int axis=0; axis<3; ++axis){
+                    auto dst=t[axis];
+                    if(p.position[axis]<0){
+                        for(int f=0; f<n; ++f){
+                            dst[f]=offset[axis];
+                        }
+                    }
+                    else{
+                        auto column=m.column(p.position[axis]);
+                        for(int f=0; f<n; ++f){
+                            dst[f]=offset[axis]+column[first_frame+f];
+                        }
+                    }
+                }
+
+                // local rotation in the channel order
+                for(int i=0; i<9; ++i){
+                    auto value=i%4==0 ? 1.0f : 0.0f;
+                    for(int f=0; f<n; ++f){
+                        local[i][f]=value;
+                    }
+                }
+                for(int c=0; c<p.rotation_count; ++c){
+                    auto column=m.column(p.rotation[c]);
+                    for(int f=0; f<n; ++f){
+                        auto radian=column[first_frame+f]*to_radian;
+                        cos_a[f]=cosf(radian);
+                        sin_a[f]=sinf(radian);
+                    }
+                    rotate(local, cos_a, sin_a, p.axis[c], n);
+                }
+
+                // world. the parent is done
+                auto dst=p.joint*frames+block;
+                if(p.parent<0){
+                    for(int f=0; f<n; ++f){
+                        out.px[dst+f]=t[0][f];
+                        out.py[dst+f]=t[1][f];
+                        out.pz[dst+f]=t[2][f];
+                    }
+                    for(int i=0; i<9; ++i){
+                        auto r=&out.r[i][dst];
+                        for(int f=0; f<n; ++f){
+                            r[f]=local[i][f];
+                        }
+                    }
+                    continue;
+                }
+                auto src=p.parent*frames+block;
+                const float *pr[9];
+                for(int i=0; i<9; ++i){
+                    pr[i]=&out.r[i][src];
+                }
+                auto ppx=&out.px[src];
+                auto ppy=&out.py[src];
+                auto ppz=&out.pz[src];
+                auto wx=&out.px[dst];
+                auto wy=&out.py[dst];
+                auto wz=&out.pz[dst];
+                for(int f=0; f<n; ++f){
+                    wx[f]=ppx[f]+pr[0][f]*t[0][f]+pr[1][f]*t[1][f]+pr[2][f]*t[2][f];
+                    wy[f]=ppy[f]+pr[3][f]*t[0][f]+pr[4][f]*t[1][f]+pr[5][f]*t[2][f];
+                    wz[f]=ppz[f]+pr[6][f]*t[0][f]+pr[7][f]*t[1][f]+pr[8][f]*t[2][f];
+                }
+                for(int row=0; row<3; ++row){
+                    for(int col=0; col<3; ++col){
+                        auto w=&out.r[row*3+col][dst];
+                        auto a0=pr[row*3+0];
+                        auto a1=pr[row*3+1];
+                        auto a2=pr[row*3+2];
+                        auto b0=local[0*3+col];
+                        auto b1=local[1*3+col];
+                        auto b2=local[2*3+col];
+                        for(int f=0; f<n; ++f){
+                            w[f]=a0[f]*b0[f]+a1[f]*b1[f]+a2[f]*b2[f];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /// m=m*R(axis, angle). the columns i and j of the axis turn.
+    static void rotate(float (&m)[9][block_frames], const float *cos_a, const float *sin_a, int axis, int n)
+    {
+        // x: (y, z), y: (z, x), z: (x, y)
+        const int i=(axis+1)%3;
+        const int j=(axis+2)%3;
+        for(int row=0; row<3; ++row){
+            auto ci=m[row*3+i];
+            auto cj=m[row*3+j];
+            for(int f=0; f<n; ++f){
+                auto vi=ci[f];
+                auto vj=cj[f];
+                ci[f]=cos_a[f]*vi+sin_a[f]*vj;
+                cj[f]=cos_a[f]*vj-sin_a[f]*vi;
+            }
+        }
+    }
+};
+
+
+} // namespace
+} // namespace
+} // namespace
@@ -1,9 +1,24 @@
 #pragma once
 #include <functional>
-#include <sstream>
+#include <deque>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
 #include <refrange/msgpack/utility.h>
 #include <refrange/msgpack/basic_overload.h>
 #include "../text.h"
+#include "../simd.h"
+#include "number.h"
+
+#if !defined(REFRANGE_JSON_NO_SIMD)
+#if defined(REFRANGE_SIMD_AVX2)
+#define REFRANGE_JSON_AVX2
+#elif defined(REFRANGE_SIMD_SSE2)
+#define REFRANGE_JSON_SSE2
+#endif
+#endif
 
 
 namespace refrange {
@@ -12,109 +27,340 @@ namespace json {
 
     typedef std::function<size_t(unsigned char *, size_t)> reader_t;
 
+    inline bool is_digit(char c)
+    {
+        return c>='0' && c<='9';
+    }
+
+    inline bool is_number_char(unsigned char c)
+    {
+        switch(c)
+        {
+            case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9':
+            case '-': case '+': case '.': case 'e': case 'E':
+                return true;
+        }
+        return false;
+    }
+
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    inline bool pack_number(::refrange::msgpack::packer &packer, const char *begin, const char *end)
+    {
+        number_parts parts;
+        if(scan_number(begin, end, parts)!=end){
+            return false;
+        }
+
+        if(parts.is_integer){
+            auto n=parts.mantissa;
+            bool overflow=false;
+            if(parts.truncated){
+                // more than 19 digits may still fit in uint64
+                n=0;
+                for(auto p=begin+(parts.negative ? 1 : 0); p<end; ++p){
+                    unsigned d=*p-'0';
+                    if(n>(0xFFFFFFFFFFFFFFFFull-d)/10){
+                        overflow=true;
+                        break;
+                    }
+                    n=n*10+d;
+                }
+            }
+            if(!overflow){
+                if(!parts.negative){
+                    packer.pack_int(n);
+                    return true;
+                }
+                if(n<=0x8000000000000000ull){
+                    packer.pack_int(static_cast<long long>(0-n));
+                    return true;
+                }
+            }
+        }
+
+        packer.pack_double(to_double(parts));
+        return true;
+    }
+
+    inline int hex_value(unsigned char c)
+    {
+        if(c>='0' && c<='9'){
+            return c-'0';
+        }
+        if(c>='a' && c<='f'){
+            return c-'a'+10;
+        }
+        if(c>='A' && c<='F'){
+            return c-'A'+10;
+        }
+        return -1;
+    }
+
+    inline bool read_hex4(const unsigned char *&p, const unsigned char *end, unsigned int &u)
+    {
+        if(end-p<4){
+            return false;
+        }
+        u=0;
+        for(int i=0; i<4; ++i, ++p){
+            int h=hex_value(*p);
+            if(h<0){
+                return false;
+            }
+            u=(u<<4) | h;
+        }
+        return true;
+    }
+
+    inline void push_utf8(std::string &out, unsigned int cp)
+    {
+        if(cp<0x80){
+            out.push_back(static_cast<char>(cp));
+        }
+        else if(cp<0x800){
+            out.push_back(static_cast<char>(0xC0 | (cp>>6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if(cp<0x10000){
+            out.push_back(static_cast<char>(0xE0 | (cp>>12)));
+            out.push_back(static_cast<char>(0x80 | ((cp>>6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else{
+            out.push_back(static_cast<char>(0xF0 | (cp>>18)));
+            out.push_back(static_cast<char>(0x80 | ((cp>>12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp>>6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    /// string body between the quotes to utf-8. false for an invalid escape or a control character.
+    inline bool unescape(const unsigned char *p, const unsigned char *end, std::string &out)
+    {
+        out.clear();
+        while(p<end){
+            // plain run
+            auto run=p;
+            while(p<end && *p!='\\' && *p>=0x20){
+                ++p;
+            }
+            out.append(run, p);
+            if(p==end){
+                break;
+            }
+            if(*p!='\\'){
+                // control character
+                return false;
+            }
+            if(++p==end){
+                return false;
+            }
+            switch(*p++)
+            {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u':
+                    {
+                        unsigned int cp;
+                        if(!read_hex4(p, end, cp)){
+                            return false;
+                        }
+                        if(cp>=0xDC00 && cp<=0xDFFF){
+                            // lone low surrogate
+                            return false;
+                        }
+                        if(cp>=0xD800 && cp<=0xDBFF){
+                            // high surrogate. a low surrogate has to follow.
+                            unsigned int low;
+                            if(end-p<2 || p[0]!='\\' || p[1]!='u'){
+                                return false;
+                            }
+                            p+=2;
+                            if(!read_hex4(p, end, low) || low<0xDC00 || low>0xDFFF){
+                                return false;
+                            }
+                            cp=0x10000+((cp-0xD800)<<10)+(low-0xDC00);
+                        }
+                        push_utf8(out, cp);
+                    }
+                    break;
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+
+    /// json to msgpack.
+    /// reads from an immutable_range in place, or from a reader_t chunk by chunk.
     class parser
     {
-        reader_t &m_reader;
-        int m_peek_char;
+        reader_t m_reader;
+        std::vector<unsigned char> m_chunk;
+        const unsigned char *m_cur;
+        const unsigned char *m_end;
+        bool m_eof;
+
+        // string that crosses a chunk boundary or has escapes
+        std::string m_scratch;
+        std::string m_unescaped;
+        // content of the open containers. reused across values.
+        std::deque<std::vector<unsigned char>> m_nested;
+        size_t m_depth;
 
     public:
-        parser(reader_t &reader)
-            : m_reader(reader), m_peek_char(-1)
+        enum { default_chunk_size=64*1024 };
+
+        parser(reader_t &reader, size_t chunk_size=default_chunk_size)
+            : m_reader(reader), m_chunk(chunk_size), m_cur(0), m_end(0), m_eof(false), m_depth(0)
+        {}
+
+        parser(const immutable_range &json)
+            : m_cur(json.begin()), m_end(json.end()), m_eof(true), m_depth(0)
         {}
 
-        bool parse(::refrange::msgpack::packer &packer, bool is_key=false)
+        /// an in place parser moves on to other json. the buffers are kept.
+        void reset(const immutable_range &json)
+        {
+            m_cur=json.begin();
+            m_end=json.end();
+            m_eof=true;
+            m_depth=0;
+        }
+
+        /// one value. false for malformed json.
+        bool parse(::refrange::msgpack::packer &packer)
         {
             switch(peek_char(true))
             {
                 case '{': return parse_object(packer);
                 case '[': return parse_array(packer);
-				case '"': return parse_quated_string(packer, '"');
-				case '0':
-				case '1':
-				case '2':
-				case '3':
-				case '4':
-				case '5':
-				case '6':
-				case '7':
-				case '8':
-				case '9':
-					return parse_number(packer);
-				default: throw std::invalid_argument(__FUNCTION__);
+                case '"': return parse_quated_string(packer);
+                case 't': return parse_literal(packer, "true");
+                case 'f': return parse_literal(packer, "false");
+                case 'n': return parse_literal(packer, "null");
+                case '-':
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9':
+                    return parse_number(packer);
+                case -1: throw std::range_error("EOF");
+                default: return false;
             }
         }
 
-    private:
-        char get_char(bool skip=false)
+        /// only spaces are left
+        bool is_end()
         {
-            if(!skip){
-                if(m_peek_char!=-1){
-                    char c=m_peek_char;
-                    m_peek_char=-1;
-                    return c;
-                }
+            return peek_char(true)==-1;
+        }
 
-                char c;
-                size_t size=m_reader((unsigned char*)&c, 1);
-                if(size==0){
-                    return 0;
-                }
-                return c;
+        /// the current position for an in place parser
+        const unsigned char *get_current()const{ return m_cur; }
+
+    private:
+        bool fill()
+        {
+            if(m_eof){
+                return false;
             }
-            else{
-                if(m_peek_char!=-1 && !text::is_space(&m_peek_char)){
-                    char c=m_peek_char;
-                    m_peek_char=-1;
-                    return c;
-                }
+            auto size=m_reader(&m_chunk[0], m_chunk.size());
+            if(size==0){
+                m_eof=true;
+                return false;
+            }
+            m_cur=&m_chunk[0];
+            m_end=m_cur+size;
+            return true;
+        }
 
-                m_peek_char=-1;
+        static bool is_space(unsigned char c)
+        {
+            return c==' ' || c=='\n' || c=='\r' || c=='\t';
+        }
 
-                while(true){
-                    char c;
-                    size_t size=m_reader((unsigned char*)&c, 1);
-                    if(size==0){
-                        throw std::exception("EOF");
-                    }
-                    if(!text::is_space(&c)){
-                        return c;
+        int peek_char(bool skip=false)
+        {
+            while(true){
+                if(skip){
+                    while(m_cur<m_end && is_space(*m_cur)){
+                        ++m_cur;
                     }
                 }
+                if(m_cur<m_end){
+                    return *m_cur;
+                }
+                if(!fill()){
+                    return -1;
+                }
             }
         }
 
-        char peek_char(bool skip=false)
+        unsigned char get_char()
         {
-            if(!skip){
-                if(m_peek_char==-1){
-                    m_peek_char=get_char();
-                }
-
-                return m_peek_char;
+            if(m_cur==m_end && !fill()){
+                throw std::range_error("EOF");
             }
+            return *m_cur++;
+        }
 
-            if(m_peek_char!=-1 && !text::is_space(&m_peek_char)){
-                return m_peek_char;
+        ::refrange::msgpack::packer create_nested_packer()
+        {
+            if(m_depth==m_nested.size()){
+                m_nested.push_back(std::vector<unsigned char>());
             }
+            auto &buffer=m_nested[m_depth++];
+            buffer.clear();
+            return ::refrange::msgpack::create_external_vector_packer(buffer);
+        }
 
-            m_peek_char=get_char(true);
-            return m_peek_char;
+        void close_nested(::refrange::msgpack::packer &packer, ::refrange::msgpack::packer &nested, bool is_map)
+        {
+            --m_depth;
+            if(nested.items()==0){
+                // begin_collection does not close an empty collection
+                packer.new_item();
+                packer.write_value(static_cast<unsigned char>(is_map 
+                            ? ::refrange::msgpack::fixmap_tag::bits
+                            : ::refrange::msgpack::fixarray_tag::bits));
+                return;
+            }
+            if(is_map){
+                packer << ::refrange::msgpack::map(nested);
+            }
+            else{
+                packer << ::refrange::msgpack::array(nested);
+            }
         }
 
         bool parse_object(::refrange::msgpack::packer &packer)
         {
             // nest packer
-			auto nested = ::refrange::msgpack::create_vector_packer();
+            auto nested=create_nested_packer();
 
             // drop open brace
-			assert(m_peek_char == '{');
             get_char();
 
-            // search key
             for(int i=0; true; ++i){
-                char c=peek_char(true);
+                int c=peek_char(true);
                 if(c=='}'){
                     // close
+                    get_char();
                     break;
                 }
                 if(i){
@@ -123,151 +369,569 @@ namespace json {
                     }
                     // drop
                     get_char();
+                    c=peek_char(true);
                 }
 
-                if(!parse(nested, true)){
+                // key
+                if(c!='"' || !parse_quated_string(nested)){
+                    return false;
+                }
+                if(peek_char(true)!=':'){
                     return false;
                 }
+                get_char();
 
-				if (get_char(true) != ':'){
+                // value
+                if(!parse(nested)){
                     return false;
                 }
+            }
+
+            close_nested(packer, nested, true);
+            return true;
+        }
+
+        bool parse_array(::refrange::msgpack::packer &packer)
+        {
+            // nest packer
+            auto nested=create_nested_packer();
+
+            // drop open bracket
+            get_char();
+
+            for(int i=0; true; ++i){
+                int c=peek_char(true);
+                if(c==']'){
+                    // close
+                    get_char();
+                    break;
+                }
+                if(i){
+                    if(c!=','){
+                        return false;
+                    }
+                    // drop
+                    get_char();
+                }
+
                 if(!parse(nested)){
                     return false;
                 }
             }
 
-            packer << ::refrange::msgpack::map(nested);
+            close_nested(packer, nested, false);
+            return true;
+        }
 
+        bool parse_literal(::refrange::msgpack::packer &packer, const char *literal)
+        {
+            for(auto l=literal; *l; ++l){
+                if(get_char()!=*l){
+                    return false;
+                }
+            }
+            switch(*literal)
+            {
+                case 't': packer.pack_bool(true); break;
+                case 'f': packer.pack_bool(false); break;
+                default: packer.pack_nil(); break;
+            }
             return true;
         }
 
-		bool parse_array(::refrange::msgpack::packer &packer)
+        bool parse_number(::refrange::msgpack::packer &packer)
         {
-            return false;
+            // in place when the number ends in this chunk
+            auto p=m_cur;
+            while(p<m_end && is_number_char(*p)){
+                ++p;
+            }
+            if(p<m_end || m_eof){
+                auto begin=m_cur;
+                m_cur=p;
+                return pack_number(packer, (const char*)begin, (const char*)p);
+            }
+
+            m_scratch.assign(m_cur, p);
+            m_cur=p;
+            while(true){
+                int c=peek_char();
+                if(c==-1 || !is_number_char(static_cast<unsigned char>(c))){
+                    break;
+                }
+                m_scratch.push_back(static_cast<char>(get_char()));
+            }
+            return pack_number(packer, m_scratch.c_str(), m_scratch.c_str()+m_scratch.size());
+        }
+
+        static bool is_plain(unsigned char c)
+        {
+            return c!='"' && c!='\\' && c>=0x20;
         }
 
-		bool is_non_numeric(char c)
-		{
-			if (text::is_space(&c)){
-				return true;
-			}
-			if (text::is_digit(&c)){
-				return false;
-			}
-
-			switch (c)
-			{
-			case ',':
-			case ':':
-			case '}':
-			case ']':
-				return true;
-			}
-
-			return false;
-		}
-
-		bool parse_number(::refrange::msgpack::packer &packer)
-		{
-			std::stringstream ss;
-			for (int i = 0; true; ++i)
-			{
-				char c = peek_char();
-				if (is_non_numeric(c)){
-					break;
-				}
-				get_char();
-				ss << c;
-			}
-
-			packer << atoi(ss.str().c_str());
-
-			return true;
-		}
-
-		bool parse_quated_string(::refrange::msgpack::packer &packer, char quote)
-		{
-			// drop first quote
-			assert(m_peek_char == quote);
-			get_char();
-
-			std::stringstream ss;
-			while (true)
-			{
-				char c=get_char();
-				if (c == quote){
-					break;
-				}
-				ss << c;
-			}
-
-			packer << ss.str();
-
-			return true;
-		}
+        bool parse_quated_string(::refrange::msgpack::packer &packer)
+        {
+            // drop first quote
+            get_char();
+
+            // in place when the string has no escape and ends in this chunk
+            auto p=m_cur;
+            while(p<m_end && is_plain(*p)){
+                ++p;
+            }
+            if(p<m_end && *p=='"'){
+                packer.pack_str((const char*)m_cur, p-m_cur);
+                m_cur=p+1;
+                return true;
+            }
+
+            // raw body up to the closing quote, then unescape
+            m_scratch.assign(m_cur, p);
+            m_cur=p;
+            bool escaped=false;
+            bool has_escape=false;
+            while(true){
+                if(m_cur==m_end && !fill()){
+                    throw std::range_error("EOF");
+                }
+                auto c=*m_cur++;
+                if(escaped){
+                    escaped=false;
+                }
+                else if(c=='\\'){
+                    escaped=true;
+                    has_escape=true;
+                }
+                else if(c=='"'){
+                    break;
+                }
+                m_scratch.push_back(static_cast<char>(c));
+            }
 
+            if(!has_escape){
+                for(auto it=m_scratch.begin(); it!=m_scratch.end(); ++it){
+                    if(static_cast<unsigned char>(*it)<0x20){
+                        return false;
+                    }
+                }
+                packer.pack_str(m_scratch.c_str(), m_scratch.size());
+                return true;
+            }
+            auto raw=(const unsigned char*)m_scratch.c_str();
+            if(!unescape(raw, raw+m_scratch.size(), m_unescaped)){
+                return false;
+            }
+            packer.pack_str(m_unescaped.c_str(), m_unescaped.size());
+            return true;
+        }
     };
 
 
+    //////////////////////////////////////////////////////////////////////////
+    // msgpack to json
+    //////////////////////////////////////////////////////////////////////////
     typedef std::function<size_t(const unsigned char *, size_t)> writer_t;
 
-    class converter
+    /// small writes are collected and handed to the writer in large blocks
+    class buffered_writer
     {
         writer_t m_writer;
+        std::vector<unsigned char> m_buffer;
+        size_t m_used;
+
+    public:
+        enum { min_capacity=4096 };
+
+        buffered_writer(const writer_t &writer, size_t capacity=64*1024)
+            : m_writer(writer), m_buffer(capacity<min_capacity ? min_capacity : capacity), m_used(0)
+        {}
+
+        void write(const void *p, size_t len)
+        {
+            if(len>m_buffer.size()-m_used){
+                flush();
+                if(len>=m_buffer.size()){
+                    write_through((const unsigned char*)p, len);
+                    return;
+                }
+            }
+            memcpy(&m_buffer[m_used], p, len);
+            m_used+=len;
+        }
+
+        void put(char c)
+        {
+            if(m_used==m_buffer.size()){
+                flush();
+            }
+            m_buffer[m_used++]=static_cast<unsigned char>(c);
+        }
+
+        /// room for len(<=min_capacity) chars. commit what was used.
+        char *reserve(size_t len)
+        {
+            if(len>m_buffer.size()-m_used){
+                flush();
+            }
+            return (char*)&m_buffer[m_used];
+        }
+
+        void commit(const char *end)
+        {
+            m_used=(const unsigned char*)end-&m_buffer[0];
+        }
+
+        void flush()
+        {
+            if(m_used){
+                write_through(&m_buffer[0], m_used);
+                m_used=0;
+            }
+        }
+
+    private:
+        void write_through(const unsigned char *p, size_t len)
+        {
+            if(m_writer(p, len)!=len){
+                throw std::range_error(__FUNCTION__);
+            }
+        }
+    };
+
+    namespace detail {
+
+        using ::refrange::simd::trailing_zeros;
+
+        /// first byte that needs an escape in json string ('"', '\\' and controls)
+        inline const unsigned char *find_escape(const unsigned char *p, const unsigned char *end)
+        {
+#if defined(REFRANGE_JSON_AVX2)
+            const __m256i quote=_mm256_set1_epi8('"');
+            const __m256i backslash=_mm256_set1_epi8('\\');
+            const __m256i control=_mm256_set1_epi8(0x1F);
+            for(; end-p>=32; p+=32){
+                auto v=_mm256_loadu_si256((const __m256i*)p);
+                auto hit=_mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                        _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+                auto mask=static_cast<unsigned int>(_mm256_movemask_epi8(hit));
+                if(mask){
+                    return p+trailing_zeros(mask);
+                }
+            }
+#elif defined(REFRANGE_JSON_SSE2)
+            const __m128i quote=_mm_set1_epi8('"');
+            const __m128i backslash=_mm_set1_epi8('\\');
+            const __m128i control=_mm_set1_epi8(0x1F);
+            for(; end-p>=16; p+=16){
+                auto v=_mm_loadu_si128((const __m128i*)p);
+                auto hit=_mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                        _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+                auto mask=static_cast<unsigned int>(_mm_movemask_epi8(hit));
+                if(mask){
+                    return p+trailing_zeros(mask);
+                }
+            }
+#endif
+            for(; p<end; ++p){
+                if(*p=='"' || *p=='\\' || *p<0x20){
+                    return p;
+                }
+            }
+            return end;
+        }
+
+    } // namespace
+
+    enum style_t
+    {
+        style_compact,
+        // 2 spaces indent
+        style_pretty,
+    };
+
+    /// msgpack values to json text.
+    ///
+    /// bin is a base64 string. ext is {"type":t,"data":"base64"}.
+    /// NaN and Infinity are null. non string keys are quoted ("1":...).
+    /// strings are written as they are, utf-8 is not validated.
+    class converter
+    {
+        buffered_writer m_out;
+        style_t m_style;
+
+        struct frame
+        {
+            size_t remaining;
+            bool is_map;
+            bool is_first;
+            // map value after the key
+            bool is_value;
+
+            frame(size_t _remaining, bool _is_map)
+                : remaining(_remaining), is_map(_is_map), is_first(true), is_value(false)
+            {}
+        };
+        std::vector<frame> m_stack;
 
     public:
-        converter(writer_t writer)
-            : m_writer(writer)
+        converter(writer_t writer, style_t style=style_compact, size_t buffer_size=64*1024)
+            : m_out(writer, buffer_size), m_style(style)
         {
         }
 
+        /// one value. the text is flushed to the writer.
         void convert(::refrange::msgpack::unpacker &u)
         {
+            m_stack.clear();
+            write_value(u);
+            while(!m_stack.empty()){
+                auto &top=m_stack.back();
+                if(top.remaining==0){
+                    bool is_map=top.is_map;
+                    m_stack.pop_back();
+                    new_line();
+                    m_out.put(is_map ? '}' : ']');
+                    continue;
+                }
+
+                if(top.is_map && top.is_value){
+                    top.is_value=false;
+                    --top.remaining;
+                    m_out.put(':');
+                    if(m_style==style_pretty){
+                        m_out.put(' ');
+                    }
+                    write_value(u);
+                    continue;
+                }
+
+                if(!top.is_first){
+                    m_out.put(',');
+                }
+                top.is_first=false;
+                new_line();
+                if(top.is_map){
+                    top.is_value=true;
+                    write_key(u);
+                }
+                else{
+                    --top.remaining;
+                    write_value(u);
+                }
+            }
+            m_out.flush();
+        }
+
+        void write(const std::string  &s)
+        {
+            m_out.write(s.c_str(), s.size());
+        }
+
+        void flush()
+        {
+            m_out.flush();
+        }
+
+    private:
+        void new_line()
+        {
+            if(m_style!=style_pretty){
+                return;
+            }
+            m_out.put('\n');
+            for(size_t i=0; i<m_stack.size(); ++i){
+                m_out.write("  ", 2);
+            }
+        }
+
+        void write_key(::refrange::msgpack::unpacker &u)
+        {
+            if(u.is_str()){
+                write_value(u);
+                return;
+            }
+            if(u.is_nil() || u.is_bool() || u.is_integer() || u.is_float()){
+                m_out.put('"');
+                write_value(u);
+                m_out.put('"');
+                return;
+            }
+            throw std::invalid_argument(__FUNCTION__);
+        }
+
+        void write_value(::refrange::msgpack::unpacker &u)
+        {
+            using namespace ::refrange::msgpack;
+
+            if(u.is_nil()){
+                u.skip();
+                m_out.write("null", 4);
+                return;
+            }
+            if(u.is_bool()){
+                bool b;
+                u >> b;
+                if(b){
+                    m_out.write("true", 4);
+                }
+                else{
+                    m_out.write("false", 5);
+                }
+                return;
+            }
+            if(u.is_integer()){
+                auto p=m_out.reserve(max_number_chars);
+                if(*u.range().get_current()==uint64_tag::bits){
+                    unsigned long long n;
+                    u >> n;
+                    m_out.commit(format_uint(p, n));
+                }
+                else{
+                    long long n;
+                    u >> n;
+                    m_out.commit(format_int(p, n));
+                }
+                return;
+            }
+            if(u.is_float()){
+                if(*u.range().get_current()==float32_tag::bits){
+                    float f;
+                    u >> f;
+                    if(f!=f || f==std::numeric_limits<float>::infinity() || f==-std::numeric_limits<float>::infinity()){
+                        m_out.write("null", 4);
+                        return;
+                    }
+                    auto p=m_out.reserve(max_number_chars);
+                    m_out.commit(format_float(p, f));
+                    return;
+                }
+                double n;
+                u >> n;
+                if(n!=n || n==std::numeric_limits<double>::infinity() || n==-std::numeric_limits<double>::infinity()){
+                    m_out.write("null", 4);
+                    return;
+                }
+                auto p=m_out.reserve(max_number_chars);
+                m_out.commit(format_double(p, n));
+                return;
+            }
+            if(u.is_str()){
+                immutable_range r;
+                auto b=create_view_buffer(r);
+                u.unpack(b);
+                write_string(r.begin(), r.end());
+                return;
+            }
+            if(u.is_bin()){
+                immutable_range r;
+                auto b=create_view_buffer(r);
+                u.unpack(b);
+                write_base64(r.begin(), r.end());
+                return;
+            }
+            if(u.is_ext()){
+                signed char type;
+                immutable_range r;
+                auto b=create_ext_view_buffer(type, r);
+                u.unpack(b);
+                m_out.write("{\"type\":", 8);
+                auto p=m_out.reserve(max_number_chars);
+                m_out.commit(format_int(p, type));
+                m_out.write(",\"data\":", 8);
+                write_base64(r.begin(), r.end());
+                m_out.put('}');
+                return;
+            }
             if(u.is_array()){
-                write("[");
+                auto c=array();
+                u >> c;
+                if(c.size==0){
+                    m_out.write("[]", 2);
+                    return;
+                }
+                m_out.put('[');
+                m_stack.push_back(frame(c.size, false));
+                return;
             }
-            else if(u.is_map()){
-                write("{");
-                auto c=::refrange::msgpack::map();
+            if(u.is_map()){
+                auto c=map();
                 u >> c;
-                for(size_t i=0; i<c.size; ++i){
-                    std::string key;
-                    u >> key;
-                    write("\"");
-                    write(key);
-                    write("\"");
-                    write(":");
-
-                    if(u.is_integer()){
-                        int n;
-                        u >> n;
-                        std::stringstream ss;
-                        ss << n;
-                        write(ss.str());
-                    }
-                    /*
-                    else if(u.is_float()){
-                    }
-                    else if(u.is_string()){
-                    }
-                    else if(u.is_bool()){
-                    }
-                    */
-                    else{
-                        // todo
-                        throw std::invalid_argument(__FUNCTION__);
-                    }
+                if(c.size==0){
+                    m_out.write("{}", 2);
+                    return;
                 }
-                write("}");
+                m_out.put('{');
+                m_stack.push_back(frame(c.size, true));
+                return;
             }
-            else{
+            throw invalid_head_byte(__FUNCTION__);
+        }
+
+        void write_string(const unsigned char *p, const unsigned char *end)
+        {
+            static const char hex[]="0123456789abcdef";
+
+            m_out.put('"');
+            while(p<end){
+                auto found=detail::find_escape(p, end);
+                m_out.write(p, found-p);
+                if(found==end){
+                    break;
+                }
+                switch(*found)
+                {
+                    case '"': m_out.write("\\\"", 2); break;
+                    case '\\': m_out.write("\\\\", 2); break;
+                    case '\b': m_out.write("\\b", 2); break;
+                    case '\f': m_out.write("\\f", 2); break;
+                    case '\n': m_out.write("\\n", 2); break;
+                    case '\r': m_out.write("\\r", 2); break;
+                    case '\t': m_out.write("\\t", 2); break;
+                    default:
+                        {
+                            char u[]={'\\', 'u', '0', '0', hex[*found>>4], hex[*found & 0xF]};
+                            m_out.write(u, sizeof(u));
+                        }
+                        break;
+                }
+                p=found+1;
             }
+            m_out.put('"');
         }
 
-        void write(const std::string  &s)
+        void write_base64(const unsigned char *p, const unsigned char *end)
         {
-            m_writer((const unsigned char*)s.c_str(), s.size());
+            static const char table[]=
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+            m_out.put('"');
+            // 3 bytes to 4 chars, a block at a time
+            static const size_t block=buffered_writer::min_capacity/4*3;
+            while(end-p>=3){
+                size_t n=std::min(static_cast<size_t>(end-p)/3*3, block);
+                auto out=m_out.reserve(n/3*4);
+                for(auto block_end=p+n; p<block_end; p+=3){
+                    unsigned int v=(p[0]<<16) | (p[1]<<8) | p[2];
+                    *out++=table[v>>18];
+                    *out++=table[(v>>12) & 0x3F];
+                    *out++=table[(v>>6) & 0x3F];
+                    *out++=table[v & 0x3F];
+                }
+                m_out.commit(out);
+            }
+            if(end-p==1){
+                unsigned int v=p[0]<<16;
+                char tail[]={table[v>>18], table[(v>>12) & 0x3F], '=', '='};
+                m_out.write(tail, 4);
+            }
+            else if(end-p==2){
+                unsigned int v=(p[0]<<16) | (p[1]<<8);
+                char tail[]={table[v>>18], table[(v>>12) & 0x3F], table[(v>>6) & 0x3F], '='};
+                m_out.write(tail, 4);
+            }
+            m_out.put('"');
         }
     };
 
@@ -0,0 +1,532 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <string.h>
+#include <limits.h>
+#include "json.h"
+
+
+namespace refrange {
+namespace text {
+namespace json {
+
+//////////////////////////////////////////////////////////////////////////////
+// structural index
+//////////////////////////////////////////////////////////////////////////////
+// stage 1 classifies 64 bytes at a time into bit masks and records the
+// position of every structural character outside strings ({}[]:,),
+// every unescaped quote (opening and closing) and the first byte of
+// every scalar (numbers, true, false, null).
+// positions are 32bit, inputs up to 4GB.
+namespace detail {
+
+    struct block_masks
+    {
+        unsigned long long quote;
+        unsigned long long backslash;
+        unsigned long long op;
+        unsigned long long space;
+    };
+
+    // bit i is the xor of bits 0..i
+    inline unsigned long long prefix_xor(unsigned long long bits)
+    {
+        bits^=bits<<1;
+        bits^=bits<<2;
+        bits^=bits<<4;
+        bits^=bits<<8;
+        bits^=bits<<16;
+        bits^=bits<<32;
+        return bits;
+    }
+
+    inline bool is_op(unsigned char c)
+    {
+        switch(c)
+        {
+            case '{': case '}': case '[': case ']': case ':': case ',':
+                return true;
+        }
+        return false;
+    }
+
+    inline bool is_space(unsigned char c)
+    {
+        return c==' ' || c=='\n' || c=='\r' || c=='\t';
+    }
+
+    inline void classify_scalar(const unsigned char *p, block_masks &m)
+    {
+        m.quote=m.backslash=m.op=m.space=0;
+        for(int i=0; i<64; ++i){
+            unsigned long long bit=1ull<<i;
+            auto c=p[i];
+            if(c=='"'){
+                m.quote|=bit;
+            }
+            else if(c=='\\'){
+                m.backslash|=bit;
+            }
+            else if(is_op(c)){
+                m.op|=bit;
+            }
+            else if(is_space(c)){
+                m.space|=bit;
+            }
+        }
+    }
+
+#if defined(REFRANGE_JSON_AVX2)
+    inline unsigned long long eq_mask(__m256i lo, __m256i hi, char c)
+    {
+        auto v=_mm256_set1_epi8(c);
+        unsigned long long l=static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, v)));
+        unsigned long long h=static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, v)));
+        return l | (h<<32);
+    }
+
+    inline void classify(const unsigned char *p, block_masks &m)
+    {
+        auto lo=_mm256_loadu_si256((const __m256i*)p);
+        auto hi=_mm256_loadu_si256((const __m256i*)(p+32));
+        m.quote=eq_mask(lo, hi, '"');
+        m.backslash=eq_mask(lo, hi, '\\');
+        m.op=eq_mask(lo, hi, '{') | eq_mask(lo, hi, '}')
+            | eq_mask(lo, hi, '[') | eq_mask(lo, hi, ']')
+            | eq_mask(lo, hi, ':') | eq_mask(lo, hi, ',');
+        m.space=eq_mask(lo, hi, ' ') | eq_mask(lo, hi, '\n')
+            | eq_mask(lo, hi, '\r') | eq_mask(lo, hi, '\t');
+    }
+#elif defined(REFRANGE_JSON_SSE2)
+    inline unsigned long long eq_mask(const __m128i *v, char c)
+    {
+        auto x=_mm_set1_epi8(c);
+        unsigned long long m0=static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(v[0], x)));
+        unsigned long long m1=static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(v[1], x)));
+        unsigned long long m2=static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(v[2], x)));
+        unsigned long long m3=static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(v[3], x)));
+        return m0 | (m1<<16) | (m2<<32) | (m3<<48);
+    }
+
+    inline void classify(const unsigned char *p, block_masks &m)
+    {
+        __m128i v[4]={
+            _mm_loadu_si128((const __m128i*)p),
+            _mm_loadu_si128((const __m128i*)(p+16)),
+            _mm_loadu_si128((const __m128i*)(p+32)),
+            _mm_loadu_si128((const __m128i*)(p+48)),
+        };
+        m.quote=eq_mask(v, '"');
+        m.backslash=eq_mask(v, '\\');
+        m.op=eq_mask(v, '{') | eq_mask(v, '}')
+            | eq_mask(v, '[') | eq_mask(v, ']')
+            | eq_mask(v, ':') | eq_mask(v, ',');
+        m.space=eq_mask(v, ' ') | eq_mask(v, '\n')
+            | eq_mask(v, '\r') | eq_mask(v, '\t');
+    }
+#else
+    inline void classify(const unsigned char *p, block_masks &m)
+    {
+        classify_scalar(p, m);
+    }
+#endif
+
+    /// state carried from one block to the next
+    struct index_state
+    {
+        // the previous block ended with an unescaped backslash
+        unsigned long long escape_carry;
+        // all ones when the previous block ended inside a string
+        unsigned long long in_string;
+        // the previous block ended in a scalar
+        unsigned long long scalar_carry;
+
+        index_state()
+            : escape_carry(0), in_string(0), scalar_carry(0)
+        {}
+    };
+
+    /// the characters that follow an unescaped backslash
+    inline unsigned long long escaped_mask(unsigned long long backslash, unsigned long long &carry)
+    {
+        unsigned long long escaped=0;
+        if(carry){
+            escaped|=1;
+            backslash&=~1ull;
+        }
+        carry=0;
+        while(backslash){
+            auto i=trailing_zeros(backslash);
+            if(i==63){
+                carry=1;
+                break;
+            }
+            escaped|=1ull<<(i+1);
+            // the escaped character can not start another escape
+            backslash&=(i>=62) ? 0 : ~((1ull<<(i+2))-1);
+        }
+        return escaped;
+    }
+
+    inline unsigned long long structural_mask(const block_masks &m, index_state &state)
+    {
+        auto quote=m.quote & ~escaped_mask(m.backslash, state.escape_carry);
+
+        // opening quotes and the inside, not the closing quotes
+        auto in_string=prefix_xor(quote) ^ state.in_string;
+        state.in_string=(in_string>>63) ? ~0ull : 0;
+
+        auto op=m.op & ~in_string;
+        auto scalar=~(m.op | m.space | quote | in_string);
+        auto scalar_start=scalar & ~((scalar<<1) | state.scalar_carry);
+        state.scalar_carry=scalar>>63;
+
+        return op | quote | scalar_start;
+    }
+
+    template<void CLASSIFY(const unsigned char *, block_masks &)>
+    inline bool build_index(const unsigned char *begin, const unsigned char *end, std::vector<unsigned int> &index)
+    {
+        index_state state;
+        block_masks m;
+        size_t size=end-begin;
+        if(size>UINT_MAX){
+            // the positions are 32bit
+            index.clear();
+            return false;
+        }
+        // grown ahead for a whole block, shrunk at the end
+        size_t count=0;
+        index.resize(size/8+64);
+        for(size_t offset=0; offset<size; offset+=64){
+            unsigned long long bits;
+            if(size-offset>=64){
+                CLASSIFY(begin+offset, m);
+                bits=structural_mask(m, state);
+            }
+            else{
+                // the last block padded with spaces
+                unsigned char tail[64];
+                memset(tail, ' ', sizeof(tail));
+                memcpy(tail, begin+offset, size-offset);
+                CLASSIFY(tail, m);
+                bits=structural_mask(m, state);
+            }
+            if(index.size()<count+64){
+                index.resize(index.size()*2);
+            }
+            auto out=&index[count];
+            while(bits){
+                *out++=static_cast<unsigned int>(offset+trailing_zeros(bits));
+                bits&=bits-1;
+            }
+            count=out-&index[0];
+        }
+        index.resize(count);
+        // unterminated string
+        return state.in_string==0;
+    }
+
+} // namespace
+
+/// structural positions with the fastest classifier of this build.
+/// false for an unterminated string or json of 4GB or more.
+inline bool build_structural_index(const immutable_range &json, std::vector<unsigned int> &index)
+{
+    return detail::build_index<detail::classify>(json.begin(), json.end(), index);
+}
+
+/// structural positions without simd
+inline bool build_structural_index_scalar(const immutable_range &json, std::vector<unsigned int> &index)
+{
+    return detail::build_index<detail::classify_scalar>(json.begin(), json.end(), index);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// indexed parser
+//////////////////////////////////////////////////////////////////////////////
+/// json to msgpack driven by the structural index.
+/// the counts of the containers come from the index, so values are
+/// packed once in place without nested buffers.
+class indexed_parser
+{
+    immutable_range m_json;
+    std::vector<unsigned int> m_index;
+    // item count of each container in open order. pairs for an object.
+    std::vector<unsigned int> m_counts;
+    bool m_valid;
+
+    size_t m_pos;
+    size_t m_container;
+    std::string m_unescaped;
+
+    enum state_t
+    {
+        state_first,
+        state_key,
+        state_colon,
+        state_value,
+        state_after,
+    };
+    struct frame
+    {
+        bool is_map;
+        state_t state;
+
+        frame(bool _is_map)
+            : is_map(_is_map), state(state_first)
+        {}
+    };
+    std::vector<frame> m_stack;
+
+public:
+    indexed_parser(const immutable_range &json)
+        : m_json(json), m_valid(true), m_pos(0), m_container(0)
+    {
+        m_valid=build_structural_index(m_json, m_index) && count_items();
+    }
+
+    const std::vector<unsigned int> &get_index()const{ return m_index; }
+
+    /// one value. false for malformed json.
+    bool parse(::refrange::msgpack::packer &packer)
+    {
+        if(!m_valid){
+            return false;
+        }
+        if(m_pos>=m_index.size()){
+            throw std::range_error("EOF");
+        }
+
+        m_stack.clear();
+        if(!begin_value(packer)){
+            return false;
+        }
+        while(!m_stack.empty()){
+            if(m_pos>=m_index.size()){
+                return false;
+            }
+            auto c=m_json.begin()[m_index[m_pos]];
+            auto &top=m_stack.back();
+            switch(top.state)
+            {
+                case state_first:
+                    if(c==(top.is_map ? '}' : ']')){
+                        ++m_pos;
+                        m_stack.pop_back();
+                        continue;
+                    }
+                    if(top.is_map){
+                        top.state=state_key;
+                        continue;
+                    }
+                    top.state=state_after;
+                    if(!begin_value(packer)){
+                        return false;
+                    }
+                    break;
+
+                case state_key:
+                    if(c!='"' || !pack_string(packer)){
+                        return false;
+                    }
+                    top.state=state_colon;
+                    break;
+
+                case state_colon:
+                    if(c!=':'){
+                        return false;
+                    }
+                    ++m_pos;
+                    top.state=state_value;
+                    break;
+
+                case state_value:
+                    top.state=state_after;
+                    if(!begin_value(packer)){
+                        return false;
+                    }
+                    break;
+
+                case state_after:
+                    ++m_pos;
+                    if(c==','){
+                        top.state=top.is_map ? state_key : state_value;
+                    }
+                    else if(c==(top.is_map ? '}' : ']')){
+                        m_stack.pop_back();
+                    }
+                    else{
+                        return false;
+                    }
+                    break;
+            }
+        }
+        return true;
+    }
+
+    /// only spaces are left
+    bool is_end()const
+    {
+        return m_valid && m_pos>=m_index.size();
+    }
+
+private:
+    bool count_items()
+    {
+        m_counts.clear();
+        // container id, commas, has an item
+        struct open_container
+        {
+            size_t id;
+            unsigned int commas;
+            bool has_item;
+            char close;
+        };
+        std::vector<open_container> stack;
+        for(size_t i=0; i<m_index.size(); ++i){
+            auto c=m_json.begin()[m_index[i]];
+            switch(c)
+            {
+                case '{':
+                case '[':
+                    if(!stack.empty()){
+                        stack.back().has_item=true;
+                    }
+                    {
+                        open_container o={ m_counts.size(), 0, false, c=='{' ? '}' : ']' };
+                        stack.push_back(o);
+                    }
+                    m_counts.push_back(0);
+                    break;
+
+                case '}':
+                case ']':
+                    if(stack.empty() || stack.back().close!=c){
+                        return false;
+                    }
+                    m_counts[stack.back().id]=stack.back().has_item ? stack.back().commas+1 : 0;
+                    stack.pop_back();
+                    break;
+
+                case ',':
+                    if(stack.empty()){
+                        return false;
+                    }
+                    ++stack.back().commas;
+                    break;
+
+                case ':':
+                    break;
+
+                case '"':
+                    // the closing quote follows
+                    ++i;
+                    // fall through
+                default:
+                    if(!stack.empty()){
+                        stack.back().has_item=true;
+                    }
+                    break;
+            }
+        }
+        return stack.empty();
+    }
+
+    void begin_collection(::refrange::msgpack::packer &packer, bool is_map)
+    {
+        auto count=m_counts[m_container++];
+        if(count==0){
+            // begin_collection does not close an empty collection
+            packer.new_item();
+            packer.write_value(static_cast<unsigned char>(is_map
+                        ? ::refrange::msgpack::fixmap_tag::bits
+                        : ::refrange::msgpack::fixarray_tag::bits));
+        }
+        else if(is_map){
+            packer << ::refrange::msgpack::map(count);
+        }
+        else{
+            packer << ::refrange::msgpack::array(count);
+        }
+        m_stack.push_back(frame(is_map));
+    }
+
+    bool pack_string(::refrange::msgpack::packer &packer)
+    {
+        if(m_pos+1>=m_index.size()){
+            return false;
+        }
+        auto begin=m_json.begin()+m_index[m_pos]+1;
+        auto end=m_json.begin()+m_index[m_pos+1];
+        m_pos+=2;
+
+        // no escape in the usual case
+        auto p=begin;
+        while(p<end && *p!='\\' && *p>=0x20){
+            ++p;
+        }
+        if(p==end){
+            packer.pack_str((const char*)begin, end-begin);
+            return true;
+        }
+        if(!unescape(begin, end, m_unescaped)){
+            return false;
+        }
+        packer.pack_str(m_unescaped.c_str(), m_unescaped.size());
+        return true;
+    }
+
+    bool begin_value(::refrange::msgpack::packer &packer)
+    {
+        auto begin=m_json.begin()+m_index[m_pos];
+        switch(*begin)
+        {
+            case '{':
+                ++m_pos;
+                begin_collection(packer, true);
+                return true;
+
+            case '[':
+                ++m_pos;
+                begin_collection(packer, false);
+                return true;
+
+            case '"':
+                return pack_string(packer);
+
+            case '}':
+            case ']':
+            case ':':
+            case ',':
+                return false;
+        }
+
+        // scalar up to a space or a structural character
+        ++m_pos;
+        auto end=begin;
+        while(end<m_json.end() && !detail::is_space(*end) && !detail::is_op(*end) && *end!='"'){
+            ++end;
+        }
+        auto len=end-begin;
+        if(len==4 && memcmp(begin, "true", 4)==0){
+            packer.pack_bool(true);
+            return true;
+        }
+        if(len==5 && memcmp(begin, "false", 5)==0){
+            packer.pack_bool(false);
+            return true;
+        }
+        if(len==4 && memcmp(begin, "null", 4)==0){
+            packer.pack_nil();
+            return true;
+        }
+        return pack_number(packer, (const char*)begin, (const char*)end);
+    }
+};
+
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,317 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <string.h>
+#include "json.h"
+#include "../thread_pool.h"
+
+
+namespace refrange {
+namespace text {
+namespace ndjson {
+
+//////////////////////////////////////////////////////////////////////////////
+// newline delimited json <-> msgpack stream
+//////////////////////////////////////////////////////////////////////////////
+// the input is cut into chunks at line (message) boundaries, the chunks are
+// converted on a thread pool and the outputs are written in the input order.
+// a wave of pool.size()*2 chunks is in flight at a time.
+
+struct parse_error: public std::invalid_argument
+{
+    // 1 origin
+    size_t line;
+
+    parse_error(size_t _line)
+        : std::invalid_argument("malformed json at line "+std::to_string(_line)), line(_line)
+    {}
+};
+
+enum { default_chunk_size=1024*1024 };
+
+
+using ::refrange::split_lines;
+
+/// chunks of about chunk_size that end at a message boundary.
+/// complete is the end of the last whole message, a truncated message may follow.
+inline std::vector<immutable_range> split_messages(const immutable_range &src, size_t chunk_size,
+        const unsigned char *&complete)
+{
+    std::vector<immutable_range> chunks;
+    auto begin=src.begin();
+    auto p=begin;
+    try{
+        while(p<src.end()){
+            p=::refrange::msgpack::skip_value(p, src.end());
+            if(static_cast<size_t>(p-begin)>=chunk_size){
+                chunks.push_back(immutable_range(begin, p));
+                begin=p;
+            }
+        }
+    }
+    catch(const std::range_error &){
+    }
+    if(begin<p){
+        chunks.push_back(immutable_range(begin, p));
+    }
+    complete=p;
+    return chunks;
+}
+
+
+namespace detail {
+
+    inline bool is_blank(unsigned char c)
+    {
+        return c==' ' || c=='\r' || c=='\t';
+    }
+
+    struct chunk_result
+    {
+        std::vector<unsigned char> output;
+        size_t lines;
+        // line in the chunk, 0 for success
+        size_t failed;
+
+        chunk_result()
+            : lines(0), failed(0)
+        {}
+    };
+
+    /// one message for each line. blank lines are skipped.
+    inline void lines_to_msgpack(json::parser &parser, const immutable_range &chunk, chunk_result &result)
+    {
+        auto packer=::refrange::msgpack::create_external_vector_packer(result.output);
+        auto p=chunk.begin();
+        auto end=chunk.end();
+        while(p<end){
+            auto nl=(const unsigned char*)memchr(p, '\n', end-p);
+            auto line_end=nl ? nl : end;
+            ++result.lines;
+
+            while(p<line_end && is_blank(*p)){
+                ++p;
+            }
+            if(p<line_end){
+                parser.reset(immutable_range(p, line_end));
+                bool ok=false;
+                try{
+                    ok=parser.parse(packer) && parser.is_end();
+                }
+                catch(const std::range_error &){
+                    // truncated
+                }
+                if(!ok){
+                    result.failed=result.lines;
+                    return;
+                }
+            }
+            p=nl ? nl+1 : end;
+        }
+    }
+
+    inline void messages_to_lines(const immutable_range &chunk, std::vector<unsigned char> &output)
+    {
+        json::converter converter([&output](const unsigned char *p, size_t len)->size_t{
+            output.insert(output.end(), p, p+len);
+            return len;
+        });
+        ::refrange::msgpack::unpacker u(chunk.begin(), chunk.end());
+        while(!u.range().is_end()){
+            converter.convert(u);
+            output.push_back('\n');
+        }
+    }
+
+    inline void write_all(const json::writer_t &writer, const std::vector<unsigned char> &output)
+    {
+        if(output.empty()){
+            return;
+        }
+        if(writer(&output[0], output.size())!=output.size()){
+            throw std::range_error(__FUNCTION__);
+        }
+    }
+
+    /// returns the lines in src. first_line is used for the error.
+    inline size_t to_msgpack(thread_pool &pool, const immutable_range &src, const json::writer_t &writer,
+            size_t chunk_size, size_t first_line)
+    {
+        auto chunks=split_lines(src, chunk_size);
+        auto wave=pool.size()*2;
+        std::vector<chunk_result> results(wave);
+        std::vector<json::parser> parsers(wave, json::parser(immutable_range()));
+
+        size_t lines=0;
+        for(size_t base=0; base<chunks.size(); base+=wave){
+            auto n=std::min(wave, chunks.size()-base);
+            parallel_for(pool, n, n, [&](size_t begin, size_t end){
+                for(size_t i=begin; i<end; ++i){
+                    results[i].output.clear();
+                    results[i].lines=0;
+                    results[i].failed=0;
+                    lines_to_msgpack(parsers[i], chunks[base+i], results[i]);
+                }
+            });
+
+            for(size_t i=0; i<n; ++i){
+                if(results[i].failed){
+                    throw parse_error(first_line+lines+results[i].failed);
+                }
+                write_all(writer, results[i].output);
+                lines+=results[i].lines;
+            }
+        }
+        return lines;
+    }
+
+    inline void to_ndjson(thread_pool &pool, const std::vector<immutable_range> &chunks, const json::writer_t &writer)
+    {
+        auto wave=pool.size()*2;
+        std::vector<std::vector<unsigned char>> outputs(wave);
+        for(size_t base=0; base<chunks.size(); base+=wave){
+            auto n=std::min(wave, chunks.size()-base);
+            parallel_for(pool, n, n, [&](size_t begin, size_t end){
+                for(size_t i=begin; i<end; ++i){
+                    outputs[i].clear();
+                    messages_to_lines(chunks[base+i], outputs[i]);
+                }
+            });
+            for(size_t i=0; i<n; ++i){
+                write_all(writer, outputs[i]);
+            }
+        }
+    }
+
+    /// read until buffer is full or eof
+    inline bool fill(const json::reader_t &reader, std::vector<unsigned char> &buffer, size_t &used)
+    {
+        while(used<buffer.size()){
+            auto size=reader(&buffer[used], buffer.size()-used);
+            if(size==0){
+                return false;
+            }
+            used+=size;
+        }
+        return true;
+    }
+
+} // namespace
+
+
+//////////////////////////////////////////////////////////////////////////////
+// ndjson -> msgpack
+//////////////////////////////////////////////////////////////////////////////
+/// one message for each line. blank lines are skipped.
+inline void to_msgpack(thread_pool &pool, const immutable_range &src, const json::writer_t &writer,
+        size_t chunk_size=default_chunk_size)
+{
+    detail::to_msgpack(pool, src, writer, chunk_size, 0);
+}
+
+inline std::vector<unsigned char> to_msgpack(thread_pool &pool, const immutable_range &src,
+        size_t chunk_size=default_chunk_size)
+{
+    std::vector<unsigned char> output;
+    to_msgpack(pool, src, [&output](const unsigned char *p, size_t len)->size_t{
+        output.insert(output.end(), p, p+len);
+        return len;
+    }, chunk_size);
+    return output;
+}
+
+/// streaming. the buffer holds about one wave of input (more for a longer line).
+inline void to_msgpack(thread_pool &pool, const json::reader_t &reader, const json::writer_t &writer,
+        size_t chunk_size=default_chunk_size)
+{
+    auto window=chunk_size*pool.size()*2;
+    std::vector<unsigned char> buffer;
+    size_t used=0;
+    size_t lines=0;
+    bool eof=false;
+    while(!eof){
+        buffer.resize(used+window);
+        eof=!detail::fill(reader, buffer, used);
+        if(used==0){
+            break;
+        }
+
+        // up to the last line break
+        auto complete=used;
+        if(!eof){
+            while(complete>0 && buffer[complete-1]!='\n'){
+                --complete;
+            }
+            if(complete==0){
+                // a line longer than the window
+                continue;
+            }
+        }
+
+        lines+=detail::to_msgpack(pool, immutable_range(&buffer[0], &buffer[0]+complete), writer, chunk_size, lines);
+        memmove(&buffer[0], &buffer[0]+complete, used-complete);
+        used-=complete;
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// msgpack -> ndjson
+//////////////////////////////////////////////////////////////////////////////
+/// one compact line for each message
+inline void to_ndjson(thread_pool &pool, const immutable_range &src, const json::writer_t &writer,
+        size_t chunk_size=default_chunk_size)
+{
+    const unsigned char *complete;
+    auto chunks=split_messages(src, chunk_size, complete);
+    if(complete!=src.end()){
+        // truncated or broken message at the end
+        ::refrange::msgpack::skip_value(complete, src.end());
+    }
+    detail::to_ndjson(pool, chunks, writer);
+}
+
+inline std::vector<unsigned char> to_ndjson(thread_pool &pool, const immutable_range &src,
+        size_t chunk_size=default_chunk_size)
+{
+    std::vector<unsigned char> output;
+    to_ndjson(pool, src, [&output](const unsigned char *p, size_t len)->size_t{
+        output.insert(output.end(), p, p+len);
+        return len;
+    }, chunk_size);
+    return output;
+}
+
+/// streaming. the buffer holds about one wave of input (more for a larger message).
+inline void to_ndjson(thread_pool &pool, const json::reader_t &reader, const json::writer_t &writer,
+        size_t chunk_size=default_chunk_size)
+{
+    auto window=chunk_size*pool.size()*2;
+    std::vector<unsigned char> buffer;
+    size_t used=0;
+    bool eof=false;
+    while(!eof){
+        buffer.resize(used+window);
+        eof=!detail::fill(reader, buffer, used);
+        if(used==0){
+            break;
+        }
+
+        immutable_range src(&buffer[0], &buffer[0]+used);
+        const unsigned char *complete;
+        auto chunks=split_messages(src, chunk_size, complete);
+        if(eof && complete!=src.end()){
+            ::refrange::msgpack::skip_value(complete, src.end());
+        }
+        detail::to_ndjson(pool, chunks, writer);
+
+        auto consumed=complete-&buffer[0];
+        memmove(&buffer[0], complete, used-consumed);
+        used-=consumed;
+    }
+}
+
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,1170 @@
+#pragma once
+#include <string.h>
+#include <limits>
+#include <cmath>
+#include "cached_powers.h"
+
+
+namespace refrange {
+namespace text {
+
+
+//////////////////////////////////////////////////////////////////////////////
+// number parsing
+//////////////////////////////////////////////////////////////////////////////
+// allocation free. doubles are correctly rounded:
+// the exact fast path (Clinger) covers the usual inputs and a decimal
+// big number conversion handles the rest.
+enum number_result_t
+{
+    number_ok,
+    number_invalid,
+    number_overflow,
+};
+
+namespace detail {
+
+    inline bool is_digit(char c)
+    {
+        return c>='0' && c<='9';
+    }
+
+    inline bool is_little_endian()
+    {
+        const unsigned short one=1;
+        return *(const unsigned char*)&one==1;
+    }
+
+    // SWAR. 8 ascii digits at a time
+    inline bool is_eight_digits(const char *p)
+    {
+        unsigned long long v;
+        memcpy(&v, p, sizeof(v));
+        return ((v & 0xF0F0F0F0F0F0F0F0ull)
+                | (((v+0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull)>>4))
+            ==0x3333333333333333ull;
+    }
+
+    inline unsigned int parse_eight_digits(const char *p)
+    {
+        unsigned long long v;
+        memcpy(&v, p, sizeof(v));
+        v=(v & 0x0F0F0F0F0F0F0F0Full)*2561>>8;
+        v=(v & 0x00FF00FF00FF00FFull)*6553601>>16;
+        return static_cast<unsigned int>((v & 0x0000FFFF0000FFFFull)*42949672960001ull>>32);
+    }
+
+    /// digits into n. count is the number of digits read.
+    /// n is valid when count<=19.
+    inline const char *read_digits(const char *p, const char *end, unsigned long long &n, int &count)
+    {
+        auto begin=p;
+        if(is_little_endian()){
+            while(end-p>=8 && is_eight_digits(p)){
+                n=n*100000000+parse_eight_digits(p);
+                p+=8;
+            }
+        }
+        while(p<end && is_digit(*p)){
+            n=n*10+(*p-'0');
+            ++p;
+        }
+        count=static_cast<int>(p-begin);
+        return p;
+    }
+
+    inline double pow10_exact(int e)
+    {
+        static const double table[]={
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        };
+        return table[e];
+    }
+
+    inline double make_double(bool negative, unsigned long long mantissa, int biased_exponent)
+    {
+        unsigned long long bits=mantissa | (static_cast<unsigned long long>(biased_exponent)<<52);
+        if(negative){
+            bits|=1ull<<63;
+        }
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    // decimal big number for the inputs the fast path can not take.
+    // value=0.d[0]d[1]...*10^decimal_point
+    //////////////////////////////////////////////////////////////////////////
+    struct decimal
+    {
+        enum { max_digits=768, decimal_point_range=2047 };
+
+        int num_digits;
+        int decimal_point;
+        bool truncated;
+        unsigned char digits[max_digits];
+
+        decimal()
+            : num_digits(0), decimal_point(0), truncated(false)
+        {}
+
+        void push(char c)
+        {
+            if(num_digits<max_digits){
+                digits[num_digits++]=static_cast<unsigned char>(c-'0');
+            }
+            else if(c!='0'){
+                truncated=true;
+            }
+        }
+
+        void trim()
+        {
+            while(num_digits>0 && digits[num_digits-1]==0){
+                --num_digits;
+            }
+        }
+
+        void clear()
+        {
+            num_digits=0;
+            decimal_point=0;
+            truncated=false;
+        }
+
+        void right_shift(int shift)
+        {
+            int read=0;
+            int write=0;
+            unsigned long long n=0;
+            while((n>>shift)==0){
+                if(read<num_digits){
+                    n=10*n+digits[read++];
+                }
+                else if(n==0){
+                    return;
+                }
+                else{
+                    while((n>>shift)==0){
+                        n=10*n;
+                        ++read;
+                    }
+                    break;
+                }
+            }
+            decimal_point-=read-1;
+            if(decimal_point<-decimal_point_range){
+                clear();
+                return;
+            }
+            auto mask=(1ull<<shift)-1;
+            while(read<num_digits){
+                auto d=static_cast<unsigned char>(n>>shift);
+                n=10*(n & mask)+digits[read++];
+                digits[write++]=d;
+            }
+            while(n>0){
+                auto d=static_cast<unsigned char>(n>>shift);
+                n=10*(n & mask);
+                if(write<max_digits){
+                    digits[write++]=d;
+                }
+                else if(d>0){
+                    truncated=true;
+                }
+            }
+            num_digits=write;
+            trim();
+        }
+
+        void left_shift(int shift)
+        {
+            if(num_digits==0){
+                return;
+            }
+            // from the last digit with the carry. 9*2^60+carry fits in 64bit.
+            unsigned char shifted[max_digits+20];
+            int pos=max_digits+20;
+            unsigned long long carry=0;
+            for(int i=num_digits-1; i>=0; --i){
+                auto n=(static_cast<unsigned long long>(digits[i])<<shift)+carry;
+                shifted[--pos]=static_cast<unsigned char>(n%10);
+                carry=n/10;
+            }
+            while(carry){
+                shifted[--pos]=static_cast<unsigned char>(carry%10);
+                carry/=10;
+            }
+            int len=max_digits+20-pos;
+            decimal_point+=len-num_digits;
+            if(len>max_digits){
+                for(int i=max_digits; i<len; ++i){
+                    if(shifted[pos+i]){
+                        truncated=true;
+                    }
+                }
+                len=max_digits;
+            }
+            memcpy(digits, shifted+pos, len);
+            num_digits=len;
+            trim();
+        }
+
+        unsigned long long round()const
+        {
+            if(num_digits==0 || decimal_point<0){
+                return 0;
+            }
+            if(decimal_point>18){
+                return ~0ull;
+            }
+            unsigned long long n=0;
+            for(int i=0; i<decimal_point; ++i){
+                n=10*n+(i<num_digits ? digits[i] : 0);
+            }
+            bool round_up=false;
+            if(decimal_point<num_digits){
+                round_up=digits[decimal_point]>=5;
+                if(digits[decimal_point]==5 && decimal_point+1==num_digits){
+                    // half way. to even
+                    round_up=truncated || (decimal_point>0 && (digits[decimal_point-1] & 1));
+                }
+            }
+            return round_up ? n+1 : n;
+        }
+
+        double to_double(bool negative)
+        {
+            if(num_digits==0 || decimal_point<-324){
+                return make_double(negative, 0, 0);
+            }
+            if(decimal_point>=310){
+                return make_double(negative, 0, 0x7FF);
+            }
+
+            static const int max_shift=60;
+            static const int powers[]={
+                0, 3, 6, 9, 13, 16, 19, 23, 26, 29, 33, 36, 39, 43, 46, 49, 53, 56, 59,
+            };
+            static const int num_powers=sizeof(powers)/sizeof(powers[0]);
+
+            // to [1/2, 1)
+            int exp2=0;
+            while(decimal_point>0){
+                int shift=decimal_point<num_powers ? powers[decimal_point] : max_shift;
+                right_shift(shift);
+                if(decimal_point<-decimal_point_range){
+                    return make_double(negative, 0, 0);
+                }
+                exp2+=shift;
+            }
+            while(decimal_point<=0){
+                int shift;
+                if(decimal_point==0){
+                    if(digits[0]>=5){
+                        break;
+                    }
+                    shift=digits[0]<2 ? 2 : 1;
+                }
+                else{
+                    shift=-decimal_point<num_powers ? powers[-decimal_point] : max_shift;
+                }
+                left_shift(shift);
+                if(decimal_point>decimal_point_range){
+                    return make_double(negative, 0, 0x7FF);
+                }
+                exp2-=shift;
+            }
+
+            // to [1, 2)
+            --exp2;
+            static const int min_exponent=-1023;
+            while(min_exponent+1>exp2){
+                int shift=(min_exponent+1)-exp2;
+                if(shift>max_shift){
+                    shift=max_shift;
+                }
+                right_shift(shift);
+                exp2+=shift;
+            }
+            if(exp2-min_exponent>=0x7FF){
+                return make_double(negative, 0, 0x7FF);
+            }
+
+            left_shift(53);
+            auto mantissa=round();
+            if(mantissa>=(1ull<<53)){
+                // rounded up to the next power of two
+                right_shift(1);
+                ++exp2;
+                mantissa=round();
+                if(exp2-min_exponent>=0x7FF){
+                    return make_double(negative, 0, 0x7FF);
+                }
+            }
+            int biased=exp2-min_exponent;
+            if(mantissa<(1ull<<52)){
+                // subnormal
+                --biased;
+            }
+            return make_double(negative, mantissa & ((1ull<<52)-1), biased);
+        }
+    };
+
+} // namespace
+
+
+/// the accepted syntax
+enum number_grammar_t
+{
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    grammar_json,
+    // [+-]?([0-9]+\.?[0-9]*|\.[0-9]+)([eE][+-]?[0-9]+)?  as strtod without inf, nan and hex.
+    // bvh, vpd and other hand written text.
+    grammar_text,
+};
+
+struct number_parts
+{
+    bool negative;
+    bool is_integer;
+    // the first 19 significant digits
+    unsigned long long mantissa;
+    // value=mantissa*10^exponent when !truncated
+    int exponent;
+    bool truncated;
+    // the whole number text
+    const char *begin;
+    const char *end;
+
+    number_parts()
+        : negative(false), is_integer(true), mantissa(0), exponent(0), truncated(false), begin(0), end(0)
+    {}
+};
+
+/// scan a number. returns the end of the number or 0 when it is not a number.
+/// stops at the first character that can not continue the number.
+inline const char *scan_number(const char *p, const char *end, number_parts &parts,
+        number_grammar_t grammar=grammar_json)
+{
+    parts=number_parts();
+    parts.begin=p;
+    if(p<end && (*p=='-' || (*p=='+' && grammar==grammar_text))){
+        parts.negative=*p=='-';
+        ++p;
+    }
+
+    // integer part
+    const char *int_begin=p;
+    int int_digits=0;
+    if(grammar==grammar_json){
+        if(p==end || !detail::is_digit(*p)){
+            return 0;
+        }
+        if(*p=='0'){
+            ++p;
+            int_digits=1;
+        }
+        else{
+            p=detail::read_digits(p, end, parts.mantissa, int_digits);
+        }
+    }
+    else{
+        // leading zeros are allowed
+        p=detail::read_digits(p, end, parts.mantissa, int_digits);
+    }
+
+    // fraction
+    int frac_digits=0;
+    if(p<end && *p=='.'){
+        auto frac_end=detail::read_digits(p+1, end, parts.mantissa, frac_digits);
+        if(frac_digits==0 && (grammar==grammar_json || int_digits==0)){
+            return 0;
+        }
+        parts.is_integer=false;
+        parts.exponent=-frac_digits;
+        p=frac_end;
+    }
+    if(int_digits==0 && frac_digits==0){
+        return 0;
+    }
+
+    // exponent
+    if(p<end && (*p=='e' || *p=='E')){
+        auto q=p+1;
+        bool negative_exp=false;
+        if(q<end && (*q=='+' || *q=='-')){
+            negative_exp=*q=='-';
+            ++q;
+        }
+        if(q<end && detail::is_digit(*q)){
+            int e=0;
+            for(; q<end && detail::is_digit(*q); ++q){
+                if(e<100000){
+                    e=e*10+(*q-'0');
+                }
+            }
+            parts.is_integer=false;
+            parts.exponent+=negative_exp ? -e : e;
+            p=q;
+        }
+        else if(grammar==grammar_json){
+            return 0;
+        }
+        // else "1e" is 1 followed by 'e'
+    }
+    parts.end=p;
+
+    // more than 19 significant digits do not fit in the mantissa
+    int significant=int_digits+frac_digits;
+    if(significant>19){
+        // leading zeros do not count
+        const char *q=int_begin;
+        while(q<p && (*q=='0' || *q=='.')){
+            if(*q=='0'){
+                --significant;
+            }
+            ++q;
+        }
+        if(significant>19){
+            parts.truncated=true;
+        }
+    }
+    return p;
+}
+
+/// correctly rounded double of the scanned number
+inline double to_double(const number_parts &parts)
+{
+    if(!parts.truncated){
+        // Clinger: exact mantissa and exact power of ten
+        if(parts.mantissa<=(1ull<<53)){
+            auto m=static_cast<double>(parts.mantissa);
+            if(parts.exponent>=0 && parts.exponent<=22){
+                m*=detail::pow10_exact(parts.exponent);
+                return parts.negative ? -m : m;
+            }
+            if(parts.exponent<0 && parts.exponent>=-22){
+                m/=detail::pow10_exact(-parts.exponent);
+                return parts.negative ? -m : m;
+            }
+            if(parts.exponent>22 && parts.exponent<=22+15){
+                // move the extra power into the mantissa while it is exact
+                auto extra=detail::pow10_exact(parts.exponent-22);
+                if(m*extra<=9007199254740992.0){
+                    m=m*extra*1e22;
+                    return parts.negative ? -m : m;
+                }
+            }
+        }
+        if(parts.mantissa==0){
+            return parts.negative ? -0.0 : 0.0;
+        }
+    }
+
+    // slow path
+    detail::decimal d;
+    const char *p=parts.begin;
+    if(*p=='-' || *p=='+'){
+        ++p;
+    }
+    int int_digits=0;
+    for(; p<parts.end && detail::is_digit(*p); ++p){
+        if(d.num_digits==0 && *p=='0'){
+            continue;
+        }
+        d.push(*p);
+        ++int_digits;
+    }
+    d.decimal_point=int_digits;
+    if(p<parts.end && *p=='.'){
+        for(++p; p<parts.end && detail::is_digit(*p); ++p){
+            if(d.num_digits==0 && *p=='0'){
+                --d.decimal_point;
+                continue;
+            }
+            d.push(*p);
+        }
+    }
+    if(p<parts.end && (*p=='e' || *p=='E')){
+        // the exponent is already in parts.exponent with the fraction digits
+        int frac=0;
+        for(const char *q=parts.begin; q<p; ++q){
+            if(*q=='.'){
+                frac=static_cast<int>(p-q-1);
+            }
+        }
+        d.decimal_point+=parts.exponent+frac;
+    }
+    d.trim();
+    return d.to_double(parts.negative);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// bounded parsers
+//////////////////////////////////////////////////////////////////////////////
+// read a number at the head of [begin, end) in grammar_text and never look
+// past end. no '\0' terminator, no locale, no allocation.
+// value is untouched when invalid and saturated when overflow.
+struct parse_result
+{
+    number_result_t status;
+    // characters used. 0 when invalid
+    size_t consumed;
+
+    parse_result(number_result_t _status=number_invalid, size_t _consumed=0)
+        : status(_status), consumed(_consumed)
+    {}
+};
+
+inline parse_result parse_int64(const char *begin, const char *end, long long &value)
+{
+    auto p=begin;
+    bool negative=false;
+    if(p<end && (*p=='-' || *p=='+')){
+        negative=*p=='-';
+        ++p;
+    }
+    auto digits=p;
+    // leading zeros do not count for the overflow
+    while(p<end && *p=='0'){
+        ++p;
+    }
+    unsigned long long n=0;
+    int count;
+    p=detail::read_digits(p, end, n, count);
+    if(p==digits){
+        return parse_result();
+    }
+
+    const unsigned long long limit=negative ? 1ull<<63 : (1ull<<63)-1;
+    if(count>19 || n>limit){
+        value=negative ? std::numeric_limits<long long>::min() : std::numeric_limits<long long>::max();
+        return parse_result(number_overflow, p-begin);
+    }
+    // -(n-1)-1 does not overflow for 2^63
+    value=negative ? -static_cast<long long>(n-1)-1 : static_cast<long long>(n);
+    return parse_result(number_ok, p-begin);
+}
+
+inline parse_result parse_int32(const char *begin, const char *end, int &value)
+{
+    long long n;
+    auto result=parse_int64(begin, end, n);
+    if(result.status==number_invalid){
+        return result;
+    }
+    if(n>std::numeric_limits<int>::max()){
+        value=std::numeric_limits<int>::max();
+        result.status=number_overflow;
+    }
+    else if(n<std::numeric_limits<int>::min()){
+        value=std::numeric_limits<int>::min();
+        result.status=number_overflow;
+    }
+    else{
+        value=static_cast<int>(n);
+    }
+    return result;
+}
+
+inline parse_result parse_double(const char *begin, const char *end, double &value)
+{
+    number_parts parts;
+    auto p=scan_number(begin, end, parts, grammar_text);
+    if(!p){
+        return parse_result();
+    }
+    value=to_double(parts);
+    if(value==std::numeric_limits<double>::infinity() || value==-std::numeric_limits<double>::infinity()){
+        return parse_result(number_overflow, p-begin);
+    }
+    return parse_result(number_ok, p-begin);
+}
+
+inline parse_result parse_float(const char *begin, const char *end, float &value)
+{
+    number_parts parts;
+    auto p=scan_number(begin, end, parts, grammar_text);
+    if(!p){
+        return parse_result();
+    }
+    if(!parts.truncated && parts.mantissa<=(1u<<24)
+            && parts.exponent>=-10 && parts.exponent<=10){
+        // exact mantissa and exact power of ten in float. correctly rounded.
+        static const float table[]={
+            1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f,
+        };
+        auto m=static_cast<float>(parts.mantissa);
+        m=parts.exponent>=0 ? m*table[parts.exponent] : m/table[-parts.exponent];
+        value=parts.negative ? -m : m;
+        return parse_result(number_ok, p-begin);
+    }
+    // through the double. may round twice in rare halfway cases.
+    value=static_cast<float>(to_double(parts));
+    if(value==std::numeric_limits<float>::infinity() || value==-std::numeric_limits<float>::infinity()){
+        return parse_result(number_overflow, p-begin);
+    }
+    return parse_result(number_ok, p-begin);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// number formatting
+//////////////////////////////////////////////////////////////////////////////
+enum { max_number_chars=32 };
+
+/// buf needs 21 chars. returns the end.
+inline char *format_uint(char *buf, unsigned long long n)
+{
+    static const char pairs[]=
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    char tmp[20];
+    char *p=tmp+sizeof(tmp);
+    while(n>=100){
+        auto i=static_cast<unsigned int>(n%100)*2;
+        n/=100;
+        *--p=pairs[i+1];
+        *--p=pairs[i];
+    }
+    if(n>=10){
+        auto i=static_cast<unsigned int>(n)*2;
+        *--p=pairs[i+1];
+        *--p=pairs[i];
+    }
+    else{
+        *--p=static_cast<char>('0'+n);
+    }
+    auto len=tmp+sizeof(tmp)-p;
+    memcpy(buf, p, len);
+    return buf+len;
+}
+
+inline char *format_int(char *buf, long long n)
+{
+    if(n<0){
+        *buf++='-';
+        return format_uint(buf, 0-static_cast<unsigned long long>(n));
+    }
+    return format_uint(buf, static_cast<unsigned long long>(n));
+}
+
+namespace detail {
+
+    // grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers")
+    struct diyfp
+    {
+        unsigned long long f;
+        int e;
+
+        diyfp(unsigned long long _f, int _e)
+            : f(_f), e(_e)
+        {}
+
+        static diyfp sub(const diyfp &x, const diyfp &y)
+        {
+            return diyfp(x.f-y.f, x.e);
+        }
+
+        // upper 64 bits of the product, rounded
+        static diyfp mul(const diyfp &x, const diyfp &y)
+        {
+            auto u_lo=x.f & 0xFFFFFFFFull;
+            auto u_hi=x.f>>32;
+            auto v_lo=y.f & 0xFFFFFFFFull;
+            auto v_hi=y.f>>32;
+
+            auto p0=u_lo*v_lo;
+            auto p1=u_lo*v_hi;
+            auto p2=u_hi*v_lo;
+            auto p3=u_hi*v_hi;
+
+            auto q=(p0>>32)+(p1 & 0xFFFFFFFFull)+(p2 & 0xFFFFFFFFull);
+            q+=1ull<<31;
+            auto h=p3+(p1>>32)+(p2>>32)+(q>>32);
+            return diyfp(h, x.e+y.e+64);
+        }
+
+        static diyfp normalize(diyfp x)
+        {
+            while((x.f>>63)==0){
+                x.f<<=1;
+                --x.e;
+            }
+            return x;
+        }
+
+        static diyfp normalize_to(const diyfp &x, int e)
+        {
+            return diyfp(x.f<<(x.e-e), e);
+        }
+    };
+
+    struct boundaries
+    {
+        diyfp w;
+        diyfp minus;
+        diyfp plus;
+
+        boundaries(const diyfp &_w, const diyfp &_minus, const diyfp &_plus)
+            : w(_w), minus(_minus), plus(_plus)
+        {}
+    };
+
+    template<typename T>
+    struct ieee_traits;
+    template<>
+    struct ieee_traits<double>
+    {
+        typedef unsigned long long bits_type;
+        enum { significand_bits=52, exponent_bias=1023 };
+    };
+    template<>
+    struct ieee_traits<float>
+    {
+        typedef unsigned int bits_type;
+        enum { significand_bits=23, exponent_bias=127 };
+    };
+
+    // positive finite value
+    template<typename T>
+    inline boundaries compute_boundaries(T value)
+    {
+        typedef ieee_traits<T> traits;
+        static const int bias=traits::exponent_bias+traits::significand_bits;
+        static const int min_exp=1-bias;
+        static const unsigned long long hidden_bit=1ull<<traits::significand_bits;
+
+        typename traits::bits_type raw;
+        memcpy(&raw, &value, sizeof(raw));
+        unsigned long long bits=raw;
+        auto E=bits>>traits::significand_bits;
+        auto F=bits & (hidden_bit-1);
+
+        auto v=E==0
+            ? diyfp(F, min_exp)
+            : diyfp(F+hidden_bit, static_cast<int>(E)-bias);
+
+        bool lower_boundary_is_closer=F==0 && E>1;
+        auto m_plus=diyfp(2*v.f+1, v.e-1);
+        auto m_minus=lower_boundary_is_closer
+            ? diyfp(4*v.f-1, v.e-2)
+            : diyfp(2*v.f-1, v.e-1);
+
+        auto w_plus=diyfp::normalize(m_plus);
+        auto w_minus=diyfp::normalize_to(m_minus, w_plus.e);
+        return boundaries(diyfp::normalize(v), w_minus, w_plus);
+    }
+
+    enum { grisu_alpha=-60, grisu_gamma=-32 };
+
+    inline const cached_power &get_cached_power(int e)
+    {
+        int f=grisu_alpha-e-1;
+        int k=(f*78913)/(1<<18)+static_cast<int>(f>0);
+        int index=(-cached_powers_min_dec_exp+k+(cached_powers_dec_step-1))/cached_powers_dec_step;
+        return cached_powers[index];
+    }
+
+    inline int find_largest_pow10(unsigned int n, unsigned int &pow10)
+    {
+        if(n>=1000000000){ pow10=1000000000; return 10; }
+        if(n>=100000000){ pow10=100000000; return 9; }
+        if(n>=10000000){ pow10=10000000; return 8; }
+        if(n>=1000000){ pow10=1000000; return 7; }
+        if(n>=100000){ pow10=100000; return 6; }
+        if(n>=10000){ pow10=10000; return 5; }
+        if(n>=1000){ pow10=1000; return 4; }
+        if(n>=100){ pow10=100; return 3; }
+        if(n>=10){ pow10=10; return 2; }
+        pow10=1;
+        return 1;
+    }
+
+    inline void grisu2_round(char *buf, int len, unsigned long long dist, unsigned long long delta,
+            unsigned long long rest, unsigned long long ten_k)
+    {
+        while(rest<dist && delta-rest>=ten_k
+                && (rest+ten_k<dist || dist-rest>rest+ten_k-dist)){
+            --buf[len-1];
+            rest+=ten_k;
+        }
+    }
+
+    inline void grisu2_digit_gen(char *buf, int &len, int &decimal_exponent,
+            const diyfp &M_minus, const diyfp &w, const diyfp &M_plus)
+    {
+        auto delta=diyfp::sub(M_plus, M_minus).f;
+        auto dist=diyfp::sub(M_plus, w).f;
+
+        diyfp one(1ull<<-M_plus.e, M_plus.e);
+        auto p1=static_cast<unsigned int>(M_plus.f>>-one.e);
+        auto p2=M_plus.f & (one.f-1);
+
+        // integral part
+        unsigned int pow10;
+        int n=find_largest_pow10(p1, pow10);
+        while(n>0){
+            auto d=p1/pow10;
+            auto r=p1%pow10;
+            buf[len++]=static_cast<char>('0'+d);
+            p1=r;
+            --n;
+
+            auto rest=(static_cast<unsigned long long>(p1)<<-one.e)+p2;
+            if(rest<=delta){
+                decimal_exponent+=n;
+                grisu2_round(buf, len, dist, delta, rest, static_cast<unsigned long long>(pow10)<<-one.e);
+                return;
+            }
+            pow10/=10;
+        }
+
+        // fractional part
+        int m=0;
+        while(true){
+            p2*=10;
+            auto d=p2>>-one.e;
+            auto r=p2 & (one.f-1);
+            buf[len++]=static_cast<char>('0'+d);
+            p2=r;
+            ++m;
+            delta*=10;
+            dist*=10;
+            if(p2<=delta){
+                break;
+            }
+        }
+        decimal_exponent-=m;
+        grisu2_round(buf, len, dist, delta, p2, one.f);
+    }
+
+    // digits in the rounding interval. value=buf*10^decimal_exponent
+    // usually the shortest, not always.
+    inline void grisu2(char *buf, int &len, int &decimal_exponent, const boundaries &b)
+    {
+        auto &cached=get_cached_power(b.plus.e);
+        diyfp c_minus_k(cached.f, cached.e);
+
+        auto w=diyfp::mul(b.w, c_minus_k);
+        auto w_minus=diyfp::mul(b.minus, c_minus_k);
+        auto w_plus=diyfp::mul(b.plus, c_minus_k);
+
+        diyfp M_minus(w_minus.f+1, w_minus.e);
+        diyfp M_plus(w_plus.f-1, w_plus.e);
+
+        len=0;
+        decimal_exponent=-cached.k;
+        grisu2_digit_gen(buf, len, decimal_exponent, M_minus, w, M_plus);
+    }
+
+    // grisu3 (the same paper). rounds toward w and tells when it can not
+    // prove that the digits are the shortest and the closest.
+    inline bool grisu3_round_weed(char *buf, int len, unsigned long long distance_too_high_w,
+            unsigned long long unsafe_interval, unsigned long long rest, unsigned long long ten_kappa,
+            unsigned long long unit)
+    {
+        auto small_distance=distance_too_high_w-unit;
+        auto big_distance=distance_too_high_w+unit;
+        while(rest<small_distance && unsafe_interval-rest>=ten_kappa
+                && (rest+ten_kappa<small_distance || small_distance-rest>=rest+ten_kappa-small_distance)){
+            --buf[len-1];
+            rest+=ten_kappa;
+        }
+        if(rest<big_distance && unsafe_interval-rest>=ten_kappa
+                && (rest+ten_kappa<big_distance || big_distance-rest>rest+ten_kappa-big_distance)){
+            return false;
+        }
+        return 2*unit<=rest && rest<=unsafe_interval-4*unit;
+    }
+
+    inline bool grisu3_digit_gen(char *buf, int &len, int &kappa,
+            const diyfp &low, const diyfp &w, const diyfp &high)
+    {
+        // the products are off by at most one unit
+        unsigned long long unit=1;
+        diyfp too_low(low.f-unit, low.e);
+        diyfp too_high(high.f+unit, high.e);
+        auto unsafe_interval=diyfp::sub(too_high, too_low).f;
+
+        diyfp one(1ull<<-w.e, w.e);
+        auto integrals=static_cast<unsigned int>(too_high.f>>-one.e);
+        auto fractionals=too_high.f & (one.f-1);
+
+        unsigned int pow10;
+        kappa=find_largest_pow10(integrals, pow10);
+        len=0;
+        while(kappa>0){
+            buf[len++]=static_cast<char>('0'+integrals/pow10);
+            integrals%=pow10;
+            --kappa;
+            auto rest=(static_cast<unsigned long long>(integrals)<<-one.e)+fractionals;
+            if(rest<unsafe_interval){
+                return grisu3_round_weed(buf, len, diyfp::sub(too_high, w).f, unsafe_interval,
+                        rest, static_cast<unsigned long long>(pow10)<<-one.e, unit);
+            }
+            pow10/=10;
+        }
+        while(true){
+            fractionals*=10;
+            unit*=10;
+            unsafe_interval*=10;
+            buf[len++]=static_cast<char>('0'+(fractionals>>-one.e));
+            fractionals&=one.f-1;
+            --kappa;
+            if(fractionals<unsafe_interval){
+                return grisu3_round_weed(buf, len, diyfp::sub(too_high, w).f*unit, unsafe_interval,
+                        fractionals, one.f, unit);
+            }
+        }
+    }
+
+    inline bool grisu3(char *buf, int &len, int &decimal_exponent, const boundaries &b)
+    {
+        auto &cached=get_cached_power(b.plus.e);
+        diyfp c_minus_k(cached.f, cached.e);
+
+        auto w=diyfp::mul(b.w, c_minus_k);
+        auto w_minus=diyfp::mul(b.minus, c_minus_k);
+        auto w_plus=diyfp::mul(b.plus, c_minus_k);
+
+        int kappa;
+        if(!grisu3_digit_gen(buf, len, kappa, w_minus, w, w_plus)){
+            return false;
+        }
+        decimal_exponent=-cached.k+kappa;
+        return true;
+    }
+
+    // correctly rounded double of digits*10^decimal_exponent
+    inline double read_back(const char *digits, int len, int decimal_exponent)
+    {
+        char text[max_number_chars];
+        memcpy(text, digits, len);
+        auto end=text+len;
+        *end++='e';
+        end=format_int(end, decimal_exponent);
+        number_parts parts;
+        scan_number(text, end, parts);
+        return to_double(parts);
+    }
+
+    // digits*10^decimal_exponent reads back to value
+    inline bool round_trips(const char *digits, int len, int decimal_exponent, double value)
+    {
+        return read_back(digits, len, decimal_exponent)==value;
+    }
+
+    inline bool round_trips(const char *digits, int len, int decimal_exponent, float value)
+    {
+        // the float halfway points are doubles and the parse is correctly rounded,
+        // so a double strictly between them comes from a number that reads back to value.
+        // one on a halfway point is rejected.
+        auto d=read_back(digits, len, decimal_exponent);
+        if(static_cast<float>(d)!=value){
+            return false;
+        }
+        auto lower=(static_cast<double>(value)+std::nextafter(value, 0.0f))/2;
+        auto upper=(static_cast<double>(value)+std::nextafter(value, std::numeric_limits<float>::infinity()))/2;
+        return lower<d && d<upper;
+    }
+
+    // drops digits while the number still reads back to value.
+    // if there is a shorter number in the rounding interval, one of the digits
+    // cut to one less digit or that plus one is in it too.
+    template<typename T>
+    inline void shorten(char *buf, int &len, int &decimal_exponent, T value)
+    {
+        char up[max_number_chars];
+        while(len>1){
+            int k=len-1;
+            // the digits cut to k
+            int down_len=k;
+            while(down_len>0 && buf[down_len-1]=='0'){
+                --down_len;
+            }
+            int down_exponent=decimal_exponent+len-down_len;
+            // plus one at the k-th digit
+            memcpy(up, buf, k);
+            int up_len=k;
+            while(up_len>0 && up[up_len-1]=='9'){
+                --up_len;
+            }
+            int up_exponent=decimal_exponent+len-up_len;
+            if(up_len==0){
+                up[0]='1';
+                up_len=1;
+            }
+            else{
+                ++up[up_len-1];
+            }
+
+            // the closer one first
+            bool up_first=buf[k]>='5';
+            bool down_ok=!up_first && down_len>0 && round_trips(buf, down_len, down_exponent, value);
+            bool up_ok=!down_ok && round_trips(up, up_len, up_exponent, value);
+            if(up_first && !up_ok){
+                down_ok=down_len>0 && round_trips(buf, down_len, down_exponent, value);
+            }
+
+            if(down_ok){
+                len=down_len;
+                decimal_exponent=down_exponent;
+            }
+            else if(up_ok){
+                memcpy(buf, up, up_len);
+                len=up_len;
+                decimal_exponent=up_exponent;
+            }
+            else{
+                break;
+            }
+        }
+    }
+
+    // the shortest digits in the rounding interval
+    template<typename T>
+    inline void shortest(char *buf, int &len, int &decimal_exponent, T value)
+    {
+        auto b=compute_boundaries(value);
+        if(grisu3(buf, len, decimal_exponent, b)){
+            return;
+        }
+        // about 0.5% of the doubles
+        grisu2(buf, len, decimal_exponent, b);
+        shorten(buf, len, decimal_exponent, value);
+    }
+
+    inline char *append_exponent(char *buf, int e)
+    {
+        if(e<0){
+            e=-e;
+            *buf++='-';
+        }
+        else{
+            *buf++='+';
+        }
+        if(e<10){
+            *buf++='0';
+            *buf++=static_cast<char>('0'+e);
+        }
+        else if(e<100){
+            *buf++=static_cast<char>('0'+e/10);
+            *buf++=static_cast<char>('0'+e%10);
+        }
+        else{
+            *buf++=static_cast<char>('0'+e/100);
+            e%=100;
+            *buf++=static_cast<char>('0'+e/10);
+            *buf++=static_cast<char>('0'+e%10);
+        }
+        return buf;
+    }
+
+    // digits to decimal or exponent notation
+    inline char *format_digits(char *buf, int k, int decimal_exponent)
+    {
+        static const int min_exp=-4;
+        static const int max_exp=15;
+
+        // the decimal point is after the n-th digit
+        int n=k+decimal_exponent;
+
+        if(k<=n && n<=max_exp){
+            // digits[000].0
+            memset(buf+k, '0', n-k);
+            buf[n]='.';
+            buf[n+1]='0';
+            return buf+n+2;
+        }
+        if(0<n && n<=max_exp){
+            // dig.its
+            memmove(buf+n+1, buf+n, k-n);
+            buf[n]='.';
+            return buf+k+1;
+        }
+        if(min_exp<n && n<=0){
+            // 0.[000]digits
+            memmove(buf+2-n, buf, k);
+            buf[0]='0';
+            buf[1]='.';
+            memset(buf+2, '0', -n);
+            return buf+2-n+k;
+        }
+
+        if(k==1){
+            // de+123
+            buf+=1;
+        }
+        else{
+            // d.igitse+123
+            memmove(buf+2, buf+1, k-1);
+            buf[1]='.';
+            buf+=1+k;
+        }
+        *buf++='e';
+        return append_exponent(buf, n-1);
+    }
+
+} // namespace
+
+namespace detail {
+
+    template<typename T>
+    inline char *format_real(char *buf, T value)
+    {
+        if(value!=value){
+            memcpy(buf, "NaN", 3);
+            return buf+3;
+        }
+        if(std::signbit(value)){
+            *buf++='-';
+            value=-value;
+        }
+        if(value==std::numeric_limits<T>::infinity()){
+            memcpy(buf, "Infinity", 8);
+            return buf+8;
+        }
+        if(value==0){
+            memcpy(buf, "0.0", 3);
+            return buf+3;
+        }
+
+        int len;
+        int decimal_exponent;
+        shortest(buf, len, decimal_exponent, value);
+        return format_digits(buf, len, decimal_exponent);
+    }
+
+} // namespace
+
+/// the shortest digits strictly inside the rounding interval, the closest one of them.
+/// grisu3, and for the inputs it can not decide grisu2 shortened with a parse back.
+/// buf needs max_number_chars.
+/// a float keeps a fraction or an exponent (1.0, 1e+100). NaN and Infinity are written as is.
+inline char *format_double(char *buf, double value)
+{
+    return detail::format_real(buf, value);
+}
+
+/// the same in float precision. 0.1f is 0.1, not the digits of the double 0.10000000149011612.
+inline char *format_float(char *buf, float value)
+{
+    return detail::format_real(buf, value);
+}
+
+} // namespace
+} // namespace
@@ -16,7 +16,7 @@ public:
     int get_int()
     {
         auto range=get_range().find_range_if(
-                &is_digit<const unsigned char>, get_current());
+                digit_class(), get_current());
         if(!range){
             throw std::invalid_argument(__FUNCTION__);
         }
@@ -59,8 +59,8 @@ public:
             // name
             {
                 auto line=reader.get_line();
-                auto splited=line.split('{');
-                auto it=splited.begin();
+                auto tokens=line.tokens('{');
+                auto it=tokens.begin();
                 ++it;
                 bone.name=it->to_str();
             }
@@ -68,8 +68,8 @@ public:
             // translation
             {
                 auto line=reader.get_line();
-                auto splited=line.split(',');
-                auto it=splited.begin();
+                auto tokens=line.tokens(',');
+                auto it=tokens.begin();
                 bone.translation.x=it->to_float();
                 ++it;
                 bone.translation.y=it->to_float();
@@ -80,8 +80,8 @@ public:
             // rotation
             {
                 auto line=reader.get_line();
-                auto splited=line.split(',');
-                auto it=splited.begin();
+                auto tokens=line.tokens(',');
+                auto it=tokens.begin();
                 bone.rotation.x=it->to_float();
                 ++it;
                 bone.rotation.y=it->to_float();
@@ -0,0 +1,123 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <algorithm>
+
+
+namespace refrange {
+
+
+class thread_pool
+{
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stop;
+
+    thread_pool(const thread_pool &);
+    thread_pool &operator=(const thread_pool &);
+
+public:
+    // threads==0 uses hardware_concurrency
+    thread_pool(size_t threads=0)
+        : m_stop(false)
+    {
+        if(threads==0){
+            threads=default_threads();
+        }
+        for(size_t i=0; i<threads; ++i){
+            m_workers.push_back(std::thread([this](){ work(); }));
+        }
+    }
+
+    ~thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop=true;
+        }
+        m_condition.notify_all();
+        for(auto it=m_workers.begin(); it!=m_workers.end(); ++it){
+            it->join();
+        }
+    }
+
+    size_t size()const{ return m_workers.size(); }
+
+    static size_t default_threads()
+    {
+        size_t n=std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+
+    template<typename F>
+        std::future<void> submit(F f)
+        {
+            auto task=std::make_shared<std::packaged_task<void()>>(f);
+            auto future=task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.push_back([task](){ (*task)(); });
+            }
+            m_condition.notify_one();
+            return future;
+        }
+
+private:
+    void work()
+    {
+        while(true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this](){ return m_stop || !m_tasks.empty(); });
+                if(m_tasks.empty()){
+                    // stopped
+                    return;
+                }
+                task=std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+
+// call f(begin, end) for each chunk of [0, count) on the pool and wait.
+// the first exception thrown by a chunk is rethrown here.
+template<typename F>
+inline void parallel_for(thread_pool &pool, size_t count, size_t chunks, F f)
+{
+    if(count==0){
+        return;
+    }
+    if(chunks==0){
+        chunks=pool.size()*4;
+    }
+    chunks=std::max<size_t>(1, std::min(chunks, count));
+    size_t step=(count+chunks-1)/chunks;
+
+    std::vector<std::future<void>> futures;
+    for(size_t begin=0; begin<count; begin+=step){
+        size_t end=std::min(count, begin+step);
+        futures.push_back(pool.submit([&f, begin, end](){ f(begin, end); }));
+    }
+    for(auto it=futures.begin(); it!=futures.end(); ++it){
+        it->wait();
+    }
+    for(auto it=futures.begin(); it!=futures.end(); ++it){
+        it->get();
+    }
+}
+
+
+} // namespace
@@ -1,5 +1,10 @@
 #pragma once
 #include <list>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <stdexcept>
+#include <algorithm>
 
 
 namespace refrange {
@@ -54,11 +59,141 @@ template<typename T>
             return 0;
         }
 
-        void add_child(node<T> &child)
+        /// adds a copy. the parents in the copied subtree point into this tree.
+        node<T> &add_child(const node<T> &child)
         {
-            child.parent=this;
             children.push_back(child);
+            auto &added=children.back();
+            added.parent=this;
+            added.update_parents();
+            return added;
+        }
+
+        void update_parents()
+        {
+            for(auto it=children.begin(); it!=children.end(); ++it){
+                it->parent=this;
+                it->update_parents();
+            }
         }
     };
 
+
+//////////////////////////////////////////////////////////////////////////////
+// flat hierarchy
+//////////////////////////////////////////////////////////////////////////////
+// nodes are indices into parallel arrays. a parent is added before its children,
+// so the index order is already parent before child.
+// order() is the depth first order. each subtree is contiguous in it.
+// it is built by finalize() after the last add.
+class flat_hierarchy
+{
+    std::vector<int> m_parents;
+    std::vector<int> m_first_children;
+    std::vector<int> m_next_siblings;
+    // appends a child in O(1)
+    std::vector<int> m_last_children;
+    // built by finalize()
+    std::vector<int> m_order;
+    std::unordered_map<std::string, int> m_names;
+
+public:
+    enum { none=-1 };
+
+    size_t size()const{ return m_parents.size(); }
+    bool empty()const{ return m_parents.empty(); }
+
+    void clear()
+    {
+        m_parents.clear();
+        m_first_children.clear();
+        m_next_siblings.clear();
+        m_last_children.clear();
+        m_order.clear();
+        m_names.clear();
+    }
+
+    void reserve(size_t n)
+    {
+        m_parents.reserve(n);
+        m_first_children.reserve(n);
+        m_next_siblings.reserve(n);
+        m_last_children.reserve(n);
+    }
+
+    /// parent is none for a root. returns the new index.
+    int add(int parent)
+    {
+        int index=static_cast<int>(m_parents.size());
+        if(parent<none || parent>=index){
+            throw std::invalid_argument(__FUNCTION__);
+        }
+        m_parents.push_back(parent);
+        m_first_children.push_back(none);
+        m_next_siblings.push_back(none);
+        m_last_children.push_back(none);
+        if(parent!=none){
+            if(m_last_children[parent]==none){
+                m_first_children[parent]=index;
+            }
+            else{
+                m_next_siblings[m_last_children[parent]]=index;
+            }
+            m_last_children[parent]=index;
+        }
+        m_order.clear();
+        return index;
+    }
+
+    /// a name for find
+    int add(int parent, const std::string &name)
+    {
+        auto index=add(parent);
+        m_names.insert(std::make_pair(name, index));
+        return index;
+    }
+
+    int parent(int i)const{ return m_parents[i]; }
+    int first_child(int i)const{ return m_first_children[i]; }
+    int next_sibling(int i)const{ return m_next_siblings[i]; }
+
+    /// contiguous. none for the roots.
+    const std::vector<int> &parents()const{ return m_parents; }
+
+    /// none if the name was not added
+    int find(const std::string &name)const
+    {
+        auto found=m_names.find(name);
+        return found==m_names.end() ? none : found->second;
+    }
+
+    /// depth first. empty until finalize() after the last add.
+    const std::vector<int> &order()const{ return m_order; }
+
+    /// builds order()
+    void finalize()
+    {
+        m_order.clear();
+        m_order.reserve(m_parents.size());
+        std::vector<int> stack;
+        for(int root=static_cast<int>(m_parents.size())-1; root>=0; --root){
+            if(m_parents[root]==none){
+                stack.push_back(root);
+            }
+        }
+        while(!stack.empty()){
+            auto i=stack.back();
+            stack.pop_back();
+            m_order.push_back(i);
+            // the first child on the top
+            auto begin=stack.size();
+            for(auto child=m_first_children[i]; child!=none; child=m_next_siblings[child]){
+                stack.push_back(child);
+            }
+            std::reverse(stack.begin()+begin, stack.end());
+        }
+    }
+};
+
+
 } // namespace
@@ -1 +1,3 @@
 C:\python27\python generate_packedmethod.py > ..\mpack\include\mpack\packedmethod.h
+C:\python27\python generate_decoder.py record "{string:int,string:[float,float,float],string:string,string:{string:bool,string:[int,string]},string:[]}" id position name flags visible tag empty > ..\tests\record_decoder.h
+C:\python27\python generate_cached_powers.py > ..\refrange\include\refrange\text\cached_powers.h
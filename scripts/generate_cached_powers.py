@@ -0,0 +1,78 @@
+#!/usr/bin/python
+# coding: utf-8
+#
+# code generator
+#
+# cached powers of ten for the shortest double formatting (grisu2)
+# in refrange/text/number.h
+#
+# generate_cached_powers.py > ../refrange/include/refrange/text/cached_powers.h
+#
+from __future__ import print_function
+from fractions import Fraction
+
+
+MIN_DEC_EXP=-300
+MAX_DEC_EXP=324
+DEC_STEP=8
+
+
+def cached_power(k):
+    """10^k ~ f * 2^e with 2^63 <= f < 2^64"""
+    v=Fraction(10)**k
+    e=v.numerator.bit_length()-v.denominator.bit_length()-64
+    while True:
+        f=v/(Fraction(2)**e)
+        if f>=2**64:
+            e+=1
+        elif f<2**63:
+            e-=1
+        else:
+            break
+    # round half up
+    r=int(f+Fraction(1, 2))
+    if r==2**64:
+        r//=2
+        e+=1
+    return r, e
+
+
+if __name__=="__main__":
+    print("""#pragma once
+//
+// this header is generated by scripts/generate_cached_powers.py
+//
+// don't modify by hand !
+//
+
+namespace refrange {
+namespace text {
+namespace detail {
+
+
+struct cached_power
+{
+    unsigned long long f;
+    int e;
+    int k;
+};
+
+enum cached_powers_t
+{
+    cached_powers_min_dec_exp=%d,
+    cached_powers_dec_step=%d,
+};
+
+static const cached_power cached_powers[]=
+{""" % (MIN_DEC_EXP, DEC_STEP))
+
+    for k in range(MIN_DEC_EXP, MAX_DEC_EXP+1, DEC_STEP):
+        f, e=cached_power(k)
+        print("    { 0x%016XULL, %5d, %4d }," % (f, e, k))
+
+    print("""};
+
+
+} // namespace
+} // namespace
+} // namespace""")
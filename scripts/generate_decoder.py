@@ -0,0 +1,349 @@
+#!/usr/bin/python
+# coding: utf-8
+#
+# code generator
+#
+# generate_decoder.py STRUCT SHAPE [KEY ...] > header.h
+#
+# SHAPE is the output of refrange::msgpack::typestruct, e.g.
+#   {string:int,string:[float,float,float]}
+# KEYs are the map keys in the order they appear in SHAPE (depth first).
+# They are used as the member names of the generated struct.
+#
+from __future__ import print_function
+import re
+import sys
+import argparse
+from string import Template
+
+
+HEADER_TEMPLATE=Template("""#pragma once
+#include <refrange/msgpack/generated.h>
+#include <array>
+//
+// this header is generated by scripts/generate_decoder.py
+//   $command
+//
+// don't modify by hand !
+//
+
+namespace refrange {
+namespace msgpack {
+
+$body
+} // namespace
+} // namespace
+""")
+
+STRUCT_TEMPLATE=Template("""
+struct $name
+{
+$members};
+""")
+
+FUNCTIONS_TEMPLATE=Template("""
+//////////////////////////////////////////////////////////////////////////////
+// $name $shape
+//////////////////////////////////////////////////////////////////////////////
+inline const unsigned char *decode(const unsigned char *p, const unsigned char *end, $name &t)
+{
+    using namespace generated;
+$decode
+    return p;
+}
+
+inline packer &encode(packer &p, const $name &t)
+{
+    using namespace generated;
+$encode
+    return p;
+}
+""")
+
+# unrolled up to this size
+UNROLL_MAX=16
+
+SCALARS={
+        # shape: (read function, pack expression)
+        "int": ("read_int", "p.pack_int($v);"),
+        "float": ("read_float", None),
+        "bool": ("read_bool", "p.pack_bool($v);"),
+        "string": ("read_str", "p.pack_str($v.c_str(), $v.size());"),
+        "byte[]": ("read_bin", "p.pack_bin($v.empty() ? 0 : &$v[0], $v.size());"),
+        }
+
+
+class ShapeError(Exception):
+    pass
+
+
+##############################################################################
+# shape
+##############################################################################
+TOKEN=re.compile(r"\s*(byte\[\]|[A-Za-z_]+|[{}\[\],:])")
+
+def tokenize(src):
+    tokens=[]
+    pos=0
+    while pos<len(src):
+        m=TOKEN.match(src, pos)
+        if not m:
+            if src[pos:].strip()=="":
+                break
+            raise ShapeError("unexpected '%s'" % src[pos:])
+        tokens.append(m.group(1))
+        pos=m.end()
+    return tokens
+
+
+class Scalar(object):
+    def __init__(self, name):
+        if name not in SCALARS:
+            raise ShapeError("unsupported type '%s'" % name)
+        self.name=name
+
+    def key(self):
+        return self.name
+
+
+class Array(object):
+    def __init__(self, items):
+        self.items=items
+
+    def key(self):
+        return "[%s]" % ",".join(x.key() for x in self.items)
+
+    def is_uniform(self):
+        return len(set(x.key() for x in self.items))==1
+
+
+class Map(object):
+    def __init__(self, values):
+        self.values=values
+        self.keys=[]
+
+    def key(self):
+        return "{%s}" % ",".join("string:%s" % x.key() for x in self.values)
+
+
+def parse(tokens):
+    pos=[0]
+
+    def peek():
+        return tokens[pos[0]] if pos[0]<len(tokens) else None
+
+    def next_token(expected=None):
+        t=peek()
+        if t is None or (expected and t!=expected):
+            raise ShapeError("'%s' expected" % expected if expected else "unexpected end")
+        pos[0]+=1
+        return t
+
+    def value():
+        t=next_token()
+        if t=="[":
+            items=[]
+            if peek()!="]":
+                items.append(value())
+                while peek()==",":
+                    next_token(",")
+                    items.append(value())
+            next_token("]")
+            return Array(items)
+        if t=="{":
+            values=[]
+            if peek()!="}":
+                while True:
+                    if next_token()!="string":
+                        raise ShapeError("only string keys are supported")
+                    next_token(":")
+                    values.append(value())
+                    if peek()!=",":
+                        break
+                    next_token(",")
+            next_token("}")
+            return Map(values)
+        return Scalar(t)
+
+    v=value()
+    if peek() is not None:
+        raise ShapeError("unexpected '%s'" % peek())
+    return v
+
+
+def assign_keys(shape, keys):
+    # depth first. a uniform array shares the keys of its first element.
+    if isinstance(shape, Map):
+        for v in shape.values:
+            if not keys:
+                raise ShapeError("not enough keys")
+            shape.keys.append(keys.pop(0))
+            assign_keys(v, keys)
+    elif isinstance(shape, Array):
+        if shape.items and shape.is_uniform():
+            assign_keys(shape.items[0], keys)
+            for x in shape.items[1:]:
+                copy_keys(shape.items[0], x)
+        else:
+            for x in shape.items:
+                assign_keys(x, keys)
+
+
+def copy_keys(src, dst):
+    if isinstance(src, Map):
+        dst.keys=src.keys
+        for s, d in zip(src.values, dst.values):
+            copy_keys(s, d)
+    elif isinstance(src, Array):
+        for s, d in zip(src.items, dst.items):
+            copy_keys(s, d)
+
+
+##############################################################################
+# generate
+##############################################################################
+def packed_str(s):
+    data=bytearray(s.encode("utf-8"))
+    if len(data)<32:
+        head=[0xa0 | len(data)]
+    elif len(data)<=0xff:
+        head=[0xd9, len(data)]
+    else:
+        raise ShapeError("key too long '%s'" % s)
+    return ", ".join("0x%02x" % b for b in head+list(data))
+
+
+class Generator(object):
+    def __init__(self, args):
+        self.args=args
+        self.structs=[]
+
+    def scalar_type(self, name):
+        return {
+                "int": self.args.int_type,
+                "float": self.args.float_type,
+                "bool": "bool",
+                "string": "std::string",
+                "byte[]": "std::vector<unsigned char>",
+                }[name]
+
+    def member_type(self, shape, name):
+        if isinstance(shape, Scalar):
+            return self.scalar_type(shape.name)
+        if isinstance(shape, Array) and shape.items and shape.is_uniform():
+            return "std::array<%s, %d>" % (self.member_type(shape.items[0], name), len(shape.items))
+        return self.struct(shape, name)
+
+    def struct(self, shape, name):
+        members=""
+        if isinstance(shape, Map):
+            for k, v in zip(shape.keys, shape.values):
+                members+="    %s %s;\n" % (self.member_type(v, "%s_%s" % (name, k)), k)
+        else:
+            for i, v in enumerate(shape.items):
+                members+="    %s item%d;\n" % (self.member_type(v, "%s_item%d" % (name, i)), i)
+        self.structs.append(STRUCT_TEMPLATE.substitute(name=name, members=members))
+        return name
+
+    def decode(self, shape, lvalue, indent):
+        sp=" "*indent
+        if isinstance(shape, Scalar):
+            return ["%sp=%s(p, end, %s);" % (sp, SCALARS[shape.name][0], lvalue)]
+        if isinstance(shape, Map):
+            lines=["%sp=read_map_head(p, end, %d);" % (sp, len(shape.values))]
+            for k, v in zip(shape.keys, shape.values):
+                lines.append('%sp=read_key(p, end, "%s", %d);' % (sp, k, len(k.encode("utf-8"))))
+                lines+=self.decode(v, "%s.%s" % (lvalue, k), indent)
+            return lines
+        lines=["%sp=read_array_head(p, end, %d);" % (sp, len(shape.items))]
+        if shape.items and shape.is_uniform():
+            if len(shape.items)>UNROLL_MAX:
+                i="i%d" % indent
+                lines.append("%sfor(size_t %s=0; %s<%d; ++%s){" % (sp, i, i, len(shape.items), i))
+                lines+=self.decode(shape.items[0], "%s[%s]" % (lvalue, i), indent+4)
+                lines.append("%s}" % sp)
+            else:
+                for i, v in enumerate(shape.items):
+                    lines+=self.decode(v, "%s[%d]" % (lvalue, i), indent)
+        else:
+            for i, v in enumerate(shape.items):
+                lines+=self.decode(v, "%s.item%d" % (lvalue, i), indent)
+        return lines
+
+    def encode(self, shape, rvalue, indent):
+        sp=" "*indent
+        if isinstance(shape, Scalar):
+            if shape.name=="float":
+                f="pack_double" if self.args.float_type=="double" else "pack_float"
+                return ["%sp.%s(%s);" % (sp, f, rvalue)]
+            return [sp+Template(SCALARS[shape.name][1]).substitute(v=rvalue)]
+        if isinstance(shape, Map):
+            lines=[self.encode_head(shape, "map", len(shape.values), indent)]
+            for k, v in zip(shape.keys, shape.values):
+                lines.append("%s{" % sp)
+                lines.append("%s    static const unsigned char key[]={%s};" % (sp, packed_str(k)))
+                lines.append("%s    write_packed(p, key, sizeof(key));" % sp)
+                lines.append("%s}" % sp)
+                lines+=self.encode(v, "%s.%s" % (rvalue, k), indent)
+            return lines
+        lines=[self.encode_head(shape, "array", len(shape.items), indent)]
+        if shape.items and shape.is_uniform():
+            if len(shape.items)>UNROLL_MAX:
+                i="i%d" % indent
+                lines.append("%sfor(size_t %s=0; %s<%d; ++%s){" % (sp, i, i, len(shape.items), i))
+                lines+=self.encode(shape.items[0], "%s[%s]" % (rvalue, i), indent+4)
+                lines.append("%s}" % sp)
+            else:
+                for i, v in enumerate(shape.items):
+                    lines+=self.encode(v, "%s[%d]" % (rvalue, i), indent)
+        else:
+            for i, v in enumerate(shape.items):
+                lines+=self.encode(v, "%s.item%d" % (rvalue, i), indent)
+        return lines
+
+    def encode_head(self, shape, kind, size, indent):
+        sp=" "*indent
+        if size==0:
+            # begin_collection does not close an empty collection
+            return "%s{ static const unsigned char head[]={0x%02x}; write_packed(p, head, 1); }" % (
+                    sp, 0x80 if kind=="map" else 0x90)
+        return "%sp.begin_collection(%s(%d));" % (sp, kind, size)
+
+    def generate(self, name, shape, command):
+        if isinstance(shape, Scalar):
+            raise ShapeError("map or array expected at the top level")
+        self.struct(shape, name)
+        body="".join(self.structs)
+        body+=FUNCTIONS_TEMPLATE.substitute(
+                name=name,
+                shape=shape.key(),
+                decode="\n".join(self.decode(shape, "t", 4)),
+                encode="\n".join(self.encode(shape, "t", 4)))
+        return HEADER_TEMPLATE.substitute(command=command, body=body)
+
+
+if __name__=="__main__":
+    parser=argparse.ArgumentParser(description="generate a fixed shape msgpack decoder and encoder")
+    parser.add_argument("struct")
+    parser.add_argument("shape")
+    parser.add_argument("keys", nargs="*")
+    parser.add_argument("--int-type", default="int")
+    parser.add_argument("--float-type", default="float", choices=["float", "double"])
+    args=parser.parse_args()
+
+    try:
+        shape=parse(tokenize(args.shape))
+        keys=list(args.keys)
+        assign_keys(shape, keys)
+        if keys:
+            raise ShapeError("too many keys")
+        options=[]
+        if args.int_type!="int":
+            options.append("--int-type '%s'" % args.int_type)
+        if args.float_type!="float":
+            options.append("--float-type %s" % args.float_type)
+        command=" ".join(["generate_decoder.py"]+options+[args.struct, "'%s'" % args.shape]+args.keys)
+        print(Generator(args).generate(args.struct, shape, command), end="")
+    except ShapeError as e:
+        sys.stderr.write("error: %s\n" % e)
+        sys.exit(1)
@@ -0,0 +1,154 @@
+#include <refrange/text/bvh_fk.h>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <algorithm>
+
+
+static std::string create_chain(const char *root_rotation, const char *joint_rotation, const std::string &frames)
+{
+    std::stringstream ss;
+    ss
+        << "HIERARCHY\n"
+        << "ROOT root\n"
+        << "{\n"
+        << "  OFFSET 0 0 0\n"
+        << "  CHANNELS 6 Xposition Yposition Zposition " << root_rotation << "\n"
+        << "  JOINT joint1\n"
+        << "  {\n"
+        << "    OFFSET 0 1 0\n"
+        << "    CHANNELS 3 " << joint_rotation << "\n"
+        << "    JOINT joint2\n"
+        << "    {\n"
+        << "      OFFSET 0 0 1\n"
+        << "      CHANNELS 3 Xrotation Yrotation Zrotation\n"
+        << "      End Site\n"
+        << "      {\n"
+        << "        OFFSET 0 1 0\n"
+        << "      }\n"
+        << "    }\n"
+        << "  }\n"
+        << "}\n"
+        << "MOTION\n"
+        << "Frames: " << std::count(frames.begin(), frames.end(), '\n') << "\n"
+        << "Frame Time: 0.033\n"
+        << frames
+        ;
+    return ss.str();
+}
+
+
+static void expect_near(const refrange::text::bvh::vec3 &v, float x, float y, float z)
+{
+    EXPECT_NEAR(x, v.x, 1e-5f);
+    EXPECT_NEAR(y, v.y, 1e-5f);
+    EXPECT_NEAR(z, v.z, 1e-5f);
+}
+
+
+TEST(BvhFkTest, chain)
+{
+    auto src=create_chain("Xrotation Yrotation Zrotation", "Xrotation Yrotation Zrotation",
+            "0 0 0 0 0 0 0 0 0 0 0 0\n"
+            "1 2 3 0 0 90 90 0 0 0 0 0\n"
+            );
+    refrange::text::bvh::loader bvh;
+    ASSERT_TRUE(bvh.load(refrange::strrange(src.c_str())));
+
+    const refrange::text::bvh::loader &header=bvh;
+    refrange::text::bvh::fk_evaluator fk(header);
+    EXPECT_EQ(3, fk.joint_count());
+
+    refrange::text::bvh::world_poses poses;
+    fk.evaluate(bvh.get_motion(), 0, 2, poses);
+    ASSERT_EQ(2, poses.frame_count());
+    ASSERT_EQ(3, poses.joint_count());
+
+    // rest pose
+    expect_near(poses.position(0, 0), 0, 0, 0);
+    expect_near(poses.position(0, 1), 0, 1, 0);
+    expect_near(poses.position(0, 2), 0, 1, 1);
+
+    // root Z 90 turns (0, 1, 0) to (-1, 0, 0)
+    expect_near(poses.position(1, 0), 1, 2, 3);
+    expect_near(poses.position(1, 1), 0, 2, 3);
+    // then joint1 X 90 turns (0, 0, 1) to (0, -1, 0)
+    expect_near(poses.position(1, 2), 1, 2, 3);
+
+    // a single frame
+    fk.evaluate(bvh.get_motion(), 1, 2, poses);
+    ASSERT_EQ(1, poses.frame_count());
+    expect_near(poses.position(0, 2), 1, 2, 3);
+}
+
+
+TEST(BvhFkTest, order)
+{
+    // X then Z is Rx*Rz
+    auto xz=create_chain("Xrotation Zrotation Yrotation", "Xrotation Yrotation Zrotation",
+            "0 0 0 90 90 0 0 0 0 0 0 0\n");
+    // Z then X is Rz*Rx
+    auto zx=create_chain("Zrotation Xrotation Yrotation", "Xrotation Yrotation Zrotation",
+            "0 0 0 90 90 0 0 0 0 0 0 0\n");
+
+    refrange::text::bvh::world_poses poses;
+    {
+        refrange::text::bvh::loader bvh;
+        ASSERT_TRUE(bvh.load(refrange::strrange(xz.c_str())));
+        refrange::text::bvh::fk_evaluator(bvh).evaluate(bvh.get_motion(), 0, 1, poses);
+        expect_near(poses.position(0, 1), -1, 0, 0);
+    }
+    {
+        refrange::text::bvh::loader bvh;
+        ASSERT_TRUE(bvh.load(refrange::strrange(zx.c_str())));
+        refrange::text::bvh::fk_evaluator(bvh).evaluate(bvh.get_motion(), 0, 1, poses);
+        expect_near(poses.position(0, 1), 0, 0, 1);
+    }
+}
+
+
+TEST(BvhFkTest, parallel)
+{
+    std::stringstream frames;
+    for(int i=0; i<1000; ++i){
+        frames
+            << i*0.1f << " 0 " << -i*0.1f << " "
+            << i%360 << " " << (i*3)%360 << " " << (i*7)%360 << " "
+            << (i*5)%360 << " 10 -20 "
+            << (i*11)%360 << " 30 " << (i*13)%360 << "\n";
+    }
+    auto src=create_chain("Zrotation Xrotation Yrotation", "Yrotation Xrotation Zrotation", frames.str());
+    refrange::text::bvh::loader bvh;
+    ASSERT_TRUE(bvh.load(refrange::strrange(src.c_str())));
+    refrange::text::bvh::fk_evaluator fk(bvh);
+
+    refrange::text::bvh::world_poses serial;
+    fk.evaluate(bvh.get_motion(), 0, 1000, serial);
+
+    refrange::thread_pool pool(4);
+    refrange::text::bvh::world_poses parallel;
+    fk.evaluate(pool, bvh.get_motion(), 0, 1000, parallel);
+
+    EXPECT_EQ(serial.px, parallel.px);
+    EXPECT_EQ(serial.py, parallel.py);
+    EXPECT_EQ(serial.pz, parallel.pz);
+    for(int i=0; i<9; ++i){
+        EXPECT_EQ(serial.r[i], parallel.r[i]);
+    }
+
+    // a sub range is the same as the whole
+    refrange::text::bvh::world_poses part;
+    fk.evaluate(pool, bvh.get_motion(), 500, 1000, part);
+    for(int f=0; f<500; ++f){
+        for(int j=0; j<3; ++j){
+            EXPECT_EQ(serial.position(500+f, j), part.position(f, j));
+        }
+    }
+
+    // bones keep their length
+    for(int f=0; f<1000; f+=97){
+        auto a=serial.position(f, 1);
+        auto b=serial.position(f, 2);
+        auto dx=b.x-a.x, dy=b.y-a.y, dz=b.z-a.z;
+        EXPECT_NEAR(1.0f, dx*dx+dy*dy+dz*dz, 1e-4f);
+    }
+}
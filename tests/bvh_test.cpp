@@ -1,5 +1,6 @@
 #include <refrange/text/bvh.h>
 #include <gtest/gtest.h>
+#include <sstream>
 
 
 auto src=
@@ -28,9 +29,10 @@ auto src=
 "  }\n"
 "}\n"
 "MOTION\n"
-"Frames: 1\n"
+"Frames: 2\n"
 "Frame Time: 0.033\n"
-"0 0 0 0 0 0 0 0 0 0 0 0\n"
+"1 2 3 4 5 6 7 8 9 10 11 12\n"
+"-1 -2 -3 -4 -5 -6 0.5 0.25 0.125 30 -45 90\n"
 ;
 
 TEST(BvhTest, loader) 
@@ -109,9 +111,172 @@ TEST(BvhTest, loader)
 
 	EXPECT_EQ(hierarchy, bvh.get_hierarchy());
 
+    auto &flat=bvh.get_flat_hierarchy();
+    ASSERT_EQ(3, flat.size());
+    EXPECT_EQ(refrange::flat_hierarchy::none, flat.parent(0));
+    EXPECT_EQ(0, flat.parent(2));
+    EXPECT_EQ(1, flat.first_child(0));
+    EXPECT_EQ(2, flat.next_sibling(1));
+    EXPECT_EQ(2, flat.find("joint2"));
+    EXPECT_EQ(refrange::flat_hierarchy::none, flat.find("joint3"));
+    EXPECT_EQ(&bvh.get_hierarchy(), bvh.get_hierarchy().children.back().parent);
+
     EXPECT_EQ(joints, bvh.get_joints());
 
-	EXPECT_EQ(bvh.get_channel_count(), bvh.get_frames().front().values.size());
+    // motion
+    auto &motion=bvh.get_motion();
+    ASSERT_EQ(12, motion.channel_count());
+    ASSERT_EQ(2, motion.frame_count());
+    EXPECT_EQ(0.033f, motion.frame_time());
+    EXPECT_EQ(1.0f, motion.at(0, 0));
+    EXPECT_EQ(6.0f, motion.at(0, 5));
+    EXPECT_EQ(12.0f, motion.at(0, 11));
+    EXPECT_EQ(-1.0f, motion.at(1, 0));
+    EXPECT_EQ(0.125f, motion.at(1, 8));
+    EXPECT_EQ(90.0f, motion.at(1, 11));
+}
+
+
+TEST(BvhTest, motion) 
+{
+    auto motion_src=
+        "HIERARCHY\n"
+        "ROOT root\n"
+        "{\n"
+        "  OFFSET 0 0 0\n"
+        "  CHANNELS 6 Xposition Yposition Zposition Zrotation Xrotation Yrotation\n"
+        "  JOINT child\n"
+        "  {\n"
+        "    OFFSET 0 1 0\n"
+        "    CHANNELS 3 Zrotation Xrotation Yrotation\n"
+        "    End Site\n"
+        "    {\n"
+        "      OFFSET 0 1 0\n"
+        "    }\n"
+        "  }\n"
+        "}\n"
+        "MOTION\n"
+        "Frames: 3\n"
+        "Frame Time: 0.5\n"
+        "0 1 2 3 4 5 6 7 8\n"
+        "10 11 12 13 14 15 16 17 18\n"
+        "20 21 22 23 24 25 26 27 28\n"
+        ;
+
+    refrange::text::bvh::loader bvh;
+    ASSERT_TRUE(bvh.load(refrange::strrange(motion_src)));
+
+    auto &motion=bvh.get_motion();
+    ASSERT_EQ(3, motion.frame_count());
+    ASSERT_EQ(9, motion.channel_count());
+    EXPECT_EQ(0.5f, motion.frame_time());
+
+    // one frame
+    EXPECT_EQ(10.0f, motion.row(1)[0]);
+    EXPECT_EQ(28.0f, motion.row(2)[8]);
+
+    // one channel over the frames
+    auto column=motion.column(7);
+    ASSERT_EQ(3, column.size());
+    EXPECT_EQ(7.0f, column[0]);
+    EXPECT_EQ(27.0f, column[2]);
+
+    // channel <-> joint
+    EXPECT_EQ(0, bvh.get_channel_offset(0));
+    EXPECT_EQ(6, bvh.get_channel_offset(1));
+    EXPECT_EQ(9, bvh.get_channel_offset(2));
+    EXPECT_EQ(0, bvh.get_channel_joint(5));
+    EXPECT_EQ(1, bvh.get_channel_joint(6));
+    EXPECT_EQ(16.0f, motion.at(1, bvh.get_channel_offset(1)));
+}
+
+
+static std::string create_bvh(int frames)
+{
+    std::string src=
+        "HIERARCHY\n"
+        "ROOT root\n"
+        "{\n"
+        "  OFFSET 0 0 0\n"
+        "  CHANNELS 6 Xposition Yposition Zposition Zrotation Xrotation Yrotation\n"
+        "  End Site\n"
+        "  {\n"
+        "    OFFSET 0 1 0\n"
+        "  }\n"
+        "}\n"
+        "MOTION\n"
+        "Frames: "+std::to_string(frames)+"\n"
+        "Frame Time: 0.0333333\n";
+    for(int i=0; i<frames; ++i){
+        for(int c=0; c<6; ++c){
+            src+=std::to_string(i)+"."+std::to_string(c)+(c<5 ? " " : "\r\n");
+        }
+        if(i%1000==0){
+            // empty lines do not count
+            src+="\n";
+        }
+    }
+    return src;
+}
+
+TEST(BvhTest, parallel) 
+{
+    auto src=create_bvh(30000);
+    refrange::thread_pool pool(4);
+
+    refrange::text::bvh::loader serial;
+    ASSERT_TRUE(serial.load(refrange::strrange(src.c_str())));
+    refrange::text::bvh::loader parallel;
+    ASSERT_TRUE(parallel.load(refrange::strrange(src.c_str()), pool));
+
+    ASSERT_EQ(30000, parallel.get_motion().frame_count());
+    EXPECT_EQ(serial.get_motion().values(), parallel.get_motion().values());
+    EXPECT_EQ(29999.5f, parallel.get_motion().at(29999, 5));
+
+    // a line without all the channels
+    auto broken=src;
+    broken.replace(broken.rfind("29000.5"), 7, "");
+    refrange::text::bvh::loader serial_broken;
+    EXPECT_FALSE(serial_broken.load(refrange::strrange(broken.c_str())));
+    refrange::text::bvh::loader parallel_broken;
+    EXPECT_FALSE(parallel_broken.load(refrange::strrange(broken.c_str()), pool));
+
+    // fewer lines than Frames
+    auto truncated=src.substr(0, src.rfind("29990.0"));
+    refrange::text::bvh::loader parallel_truncated;
+    EXPECT_FALSE(parallel_truncated.load(refrange::strrange(truncated.c_str()), pool));
+}
+
+
+TEST(BvhTest, stream) 
+{
+    auto src=create_bvh(3000);
+    refrange::text::bvh::loader whole;
+    ASSERT_TRUE(whole.load(refrange::strrange(src.c_str())));
+
+    // 7 bytes at a time through a 64 byte window
+    size_t pos=0;
+    refrange::text::bvh::stream_reader stream([&](unsigned char *p, size_t size)->size_t{
+        auto n=std::min<size_t>(std::min<size_t>(size, 7), src.size()-pos);
+        memcpy(p, src.data()+pos, n);
+        pos+=n;
+        return n;
+    }, 64);
+    ASSERT_TRUE(stream.open());
+    EXPECT_EQ(3000, stream.get_frame_count());
+    EXPECT_EQ(6, stream.get_header().get_channel_count());
+    EXPECT_EQ(whole.get_joints(), stream.get_header().get_joints());
+
+    refrange::text::bvh::motion batch;
+    std::vector<float> values;
+    size_t batches=0;
+    while(auto n=stream.read(batch, 256)){
+        values.insert(values.end(), batch.row(0), batch.row(0)+n*batch.channel_count());
+        ++batches;
+    }
+    EXPECT_EQ(12, batches);
+    EXPECT_EQ(3000, stream.get_read_frame_count());
+    EXPECT_EQ(whole.get_motion().values(), values);
 }
 
 
@@ -154,6 +319,22 @@ TEST(BvhTest, load_from_file)
 #endif
 
     EXPECT_EQ(root, bvh.get_joints().front());
-	EXPECT_EQ(bvh.get_channel_count(), bvh.get_frames().front().values.size());
+
+    // the frame count and the first frame as written in the file
+    std::string text(buf.begin(), buf.end());
+    auto frames=text.find("Frames:");
+    auto frame_time=text.find("Frame Time:");
+    ASSERT_NE(std::string::npos, frames);
+    ASSERT_NE(std::string::npos, frame_time);
+    auto &motion=bvh.get_motion();
+    ASSERT_EQ(bvh.get_channel_count(), motion.channel_count());
+    EXPECT_EQ(std::stoul(text.substr(frames+7)), motion.frame_count());
+    ASSERT_LT(0, motion.frame_count());
+    std::istringstream first(text.substr(text.find('\n', frame_time)+1));
+    for(size_t c=0; c<motion.channel_count(); ++c){
+        float value;
+        ASSERT_TRUE(static_cast<bool>(first >> value));
+        EXPECT_FLOAT_EQ(value, motion.at(0, c));
+    }
 }
 
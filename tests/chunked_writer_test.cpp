@@ -0,0 +1,87 @@
+#include <refrange/chunked_writer.h>
+#include <refrange/msgpack/basic_overload.h>
+#include <refrange/msgpack/utility.h>
+#include <gtest/gtest.h>
+
+
+TEST(ChunkedWriterTest, write)
+{
+    refrange::chunked_writer w(16);
+    std::vector<unsigned char> expected;
+    for(int i=0; i<100; ++i){
+        auto c=static_cast<unsigned char>(i);
+        w.write_value(c);
+        expected.push_back(c);
+    }
+    const unsigned char large[40]={ 1 };
+    w.write(large, sizeof(large));
+    expected.insert(expected.end(), large, large+sizeof(large));
+
+    EXPECT_EQ(140, w.size());
+    EXPECT_EQ(9, w.block_count());
+
+    // earlier data never moves
+    auto first=w.gather()[0].begin();
+    w.write(large, sizeof(large));
+    expected.insert(expected.end(), large, large+sizeof(large));
+    EXPECT_EQ(first, w.gather()[0].begin());
+
+    std::vector<unsigned char> gathered;
+    auto list=w.gather();
+    for(auto it=list.begin(); it!=list.end(); ++it){
+        gathered.insert(gathered.end(), it->begin(), it->end());
+    }
+    EXPECT_EQ(expected, gathered);
+
+    std::vector<unsigned char> written;
+    EXPECT_EQ(180, w.write_to([&written](const unsigned char *p, size_t size)->size_t{
+                written.insert(written.end(), p, p+size);
+                return size;
+                }));
+    EXPECT_EQ(expected, written);
+
+    EXPECT_TRUE(w.flatten()==refrange::vectorrange(expected));
+
+    // a block of 0 bytes never fills
+    EXPECT_THROW(refrange::chunked_writer(0), std::invalid_argument);
+    EXPECT_THROW(refrange::block_pool(0), std::invalid_argument);
+}
+
+TEST(ChunkedWriterTest, pool)
+{
+    refrange::block_pool pool(32);
+    {
+        refrange::chunked_writer w(pool);
+        const unsigned char data[100]={ 0 };
+        w.write(data, sizeof(data));
+        EXPECT_EQ(4, w.block_count());
+    }
+    EXPECT_EQ(4, pool.free_count());
+    {
+        refrange::chunked_writer w(pool);
+        const unsigned char data[40]={ 0 };
+        w.write(data, sizeof(data));
+        EXPECT_EQ(2, pool.free_count());
+        EXPECT_EQ(40, w.flatten().size());
+    }
+    EXPECT_EQ(4, pool.free_count());
+}
+
+TEST(ChunkedWriterTest, packer)
+{
+    auto w=std::make_shared<refrange::chunked_writer>(8);
+    auto p=refrange::msgpack::create_chunked_packer(w);
+    p << refrange::msgpack::array(3) << "a long string over the block size" << 1 << 2.5;
+    EXPECT_LT(1, w->block_count());
+
+    auto u=refrange::msgpack::create_unpacker_from_packer(p);
+    auto a=refrange::msgpack::array();
+    std::string s;
+    int n;
+    double d;
+    u >> a >> s >> n >> d;
+    EXPECT_EQ(3, a.size);
+    EXPECT_EQ("a long string over the block size", s);
+    EXPECT_EQ(1, n);
+    EXPECT_EQ(2.5, d);
+}
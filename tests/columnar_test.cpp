@@ -0,0 +1,98 @@
+#include <refrange/msgpack/columnar.h>
+#include <refrange/msgpack/utility.h>
+#include <gtest/gtest.h>
+
+
+static refrange::immutable_range packed_range(refrange::msgpack::packer &p)
+{
+    return refrange::immutable_range(p.pointer(), p.pointer()+p.size());
+}
+
+
+TEST(ColumnarTest, columns)
+{
+    // packing
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::array(3)
+        << refrange::msgpack::map(3) << "id" << 1 << "name" << "a" << "score" << 1
+        << refrange::msgpack::map(3) << "name" << "bb" << "id" << 2 << "score" << 2.5
+        << refrange::msgpack::map(3) << "id" << 3 << "score" << 3 << "name" << ""
+        ;
+
+    refrange::msgpack::column_table table;
+    table.load(packed_range(p));
+
+    ASSERT_EQ(3, table.rows());
+    ASSERT_EQ(3, table.get_columns().size());
+
+    auto id=table.find("id");
+    ASSERT_TRUE(id!=0);
+    EXPECT_EQ(refrange::msgpack::column_int, id->type);
+    EXPECT_EQ(3, id->ints[2]);
+
+    // promoted to float
+    auto score=table.find("score");
+    ASSERT_TRUE(score!=0);
+    EXPECT_EQ(refrange::msgpack::column_float, score->type);
+    EXPECT_EQ(1.0, score->floats[0]);
+    EXPECT_EQ(2.5, score->floats[1]);
+
+    auto name=table.find("name");
+    ASSERT_TRUE(name!=0);
+    EXPECT_EQ(refrange::msgpack::column_string, name->type);
+    EXPECT_EQ("bb", name->str(1).to_str());
+    EXPECT_EQ(0, name->str(2).size());
+}
+
+TEST(ColumnarTest, rows)
+{
+    // packing
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::array(2)
+        << refrange::msgpack::map(2) << "flag" << true << "name" << "first"
+        << refrange::msgpack::map(2) << "flag" << false << "name" << "second"
+        ;
+
+    refrange::msgpack::column_table table;
+    table.load(packed_range(p));
+
+    // back to rows
+    auto out=refrange::msgpack::create_vector_packer();
+    table.pack(out);
+
+    ASSERT_EQ(p.size(), out.size());
+    EXPECT_TRUE(std::equal(p.pointer(), p.pointer()+p.size(), out.pointer()));
+}
+
+TEST(ColumnarTest, key_mismatch)
+{
+    // packing
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::array(2)
+        << refrange::msgpack::map(1) << "a" << 1
+        << refrange::msgpack::map(1) << "b" << 1
+        ;
+
+    refrange::msgpack::column_table table;
+    EXPECT_THROW(table.load(packed_range(p)), refrange::msgpack::unpack_error);
+}
+
+TEST(ColumnarTest, duplicated_key)
+{
+    // in the first row
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::array(2)
+        << refrange::msgpack::map(2) << "a" << 1 << "a" << 2
+        << refrange::msgpack::map(2) << "a" << 3 << "a" << 4
+        ;
+    refrange::msgpack::column_table table;
+    EXPECT_THROW(table.load(packed_range(p)), refrange::msgpack::unpack_error);
+
+    // in a later row
+    auto q=refrange::msgpack::create_vector_packer();
+    q << refrange::msgpack::array(2)
+        << refrange::msgpack::map(2) << "a" << 1 << "b" << 2
+        << refrange::msgpack::map(2) << "a" << 3 << "a" << 4
+        ;
+    EXPECT_THROW(table.load(packed_range(q)), refrange::msgpack::unpack_error);
+}
@@ -0,0 +1,61 @@
+#include "record_decoder.h"
+#include <refrange/msgpack/basic_overload.h>
+#include <refrange/msgpack/utility.h>
+#include <gtest/gtest.h>
+
+
+TEST(DecoderTest, decode)
+{
+    // packing
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::map(5)
+        << "id" << 300
+        << "position" << refrange::msgpack::array(3) << 1.0f << 2.0f << 3.5
+        << "name" << "hips"
+        << "flags" << refrange::msgpack::map(2)
+            << "visible" << true
+            << "tag" << refrange::msgpack::array(2) << -2 << "root"
+        << "empty"
+        ;
+    p.new_item();
+    p.write_value(static_cast<unsigned char>(refrange::msgpack::fixarray_tag::bits));
+
+    // decode
+    refrange::msgpack::record r;
+    auto end=refrange::msgpack::decode(p.pointer(), p.pointer()+p.size(), r);
+    EXPECT_EQ(p.pointer()+p.size(), end);
+    EXPECT_EQ(300, r.id);
+    EXPECT_EQ(3.5f, r.position[2]);
+    EXPECT_EQ("hips", r.name);
+    EXPECT_TRUE(r.flags.visible);
+    EXPECT_EQ(-2, r.flags.tag.item0);
+    EXPECT_EQ("root", r.flags.tag.item1);
+
+    // encode
+    auto q=refrange::msgpack::create_vector_packer();
+    refrange::msgpack::encode(q, r);
+    refrange::msgpack::record decoded;
+    refrange::msgpack::decode(q.pointer(), q.pointer()+q.size(), decoded);
+    EXPECT_EQ(r.id, decoded.id);
+    EXPECT_EQ(r.position, decoded.position);
+    EXPECT_EQ(r.name, decoded.name);
+    EXPECT_EQ(r.flags.tag.item1, decoded.flags.tag.item1);
+}
+
+TEST(DecoderTest, mismatch)
+{
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::map(5)
+        << "id" << "not an int"
+        ;
+
+    refrange::msgpack::record r;
+    EXPECT_THROW(refrange::msgpack::decode(p.pointer(), p.pointer()+p.size(), r),
+            refrange::msgpack::generated::shape_mismatch);
+
+    // truncated
+    auto q=refrange::msgpack::create_vector_packer();
+    q << refrange::msgpack::map(5) << "id";
+    EXPECT_THROW(refrange::msgpack::decode(q.pointer(), q.pointer()+q.size(), r),
+            std::range_error);
+}
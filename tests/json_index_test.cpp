@@ -0,0 +1,122 @@
+#include <refrange/text/json_index.h>
+#include <gtest/gtest.h>
+
+
+static refrange::immutable_range to_range(const std::string &s)
+{
+    return refrange::immutable_range((const unsigned char*)s.c_str(), (const unsigned char*)s.c_str()+s.size());
+}
+
+static std::vector<unsigned char> parse_streaming(const std::string &json)
+{
+    std::vector<unsigned char> buffer;
+    auto p=refrange::msgpack::create_external_vector_packer(buffer);
+    refrange::text::json::parser parser(to_range(json));
+    while(!parser.is_end()){
+        EXPECT_TRUE(parser.parse(p));
+    }
+    return buffer;
+}
+
+static std::vector<unsigned char> parse_indexed(const std::string &json)
+{
+    std::vector<unsigned char> buffer;
+    auto p=refrange::msgpack::create_external_vector_packer(buffer);
+    refrange::text::json::indexed_parser parser(to_range(json));
+    while(!parser.is_end()){
+        EXPECT_TRUE(parser.parse(p));
+    }
+    return buffer;
+}
+
+
+TEST(JsonIndexTest, index)
+{
+    std::string json="{\"a\\\"b\":[1, true,\"x\"]}";
+    std::vector<unsigned int> index;
+    ASSERT_TRUE(refrange::text::json::build_structural_index(to_range(json), index));
+
+    // { " " : [ 1 , t , " " ] }
+    unsigned int expected[]={0, 1, 6, 7, 8, 9, 10, 12, 16, 17, 19, 20, 21};
+    ASSERT_EQ(sizeof(expected)/sizeof(expected[0]), index.size());
+    for(size_t i=0; i<index.size(); ++i){
+        EXPECT_EQ(expected[i], index[i]);
+    }
+}
+
+TEST(JsonIndexTest, simd_and_scalar)
+{
+    // escapes and strings across the 64 byte blocks
+    std::string json="[";
+    for(int i=0; i<200; ++i){
+        if(i){
+            json+=",";
+        }
+        json+="{\"key\":\"";
+        json+=std::string(i%70, 'x');
+        json+="\\\\\\\"\",\"n\":-12.5e1, \"list\":[null,false, 123456789012]}";
+    }
+    json+="]";
+
+    std::vector<unsigned int> simd;
+    std::vector<unsigned int> scalar;
+    ASSERT_TRUE(refrange::text::json::build_structural_index(to_range(json), simd));
+    ASSERT_TRUE(refrange::text::json::build_structural_index_scalar(to_range(json), scalar));
+    EXPECT_EQ(scalar, simd);
+
+    EXPECT_EQ(parse_streaming(json), parse_indexed(json));
+}
+
+TEST(JsonIndexTest, parse)
+{
+    const char *documents[]={
+        "{}",
+        "[]",
+        " [ 1 , -2 , 3.25 ] ",
+        "{\"a\":{\"b\":[[],{}]},\"c\":\"\\u00e9\\ud83d\\ude00\"}",
+        "1 \"two\" [3] {\"four\":4}",
+        "\"quote\\\\\"",
+    };
+    for(size_t i=0; i<sizeof(documents)/sizeof(documents[0]); ++i){
+        EXPECT_EQ(parse_streaming(documents[i]), parse_indexed(documents[i])) << documents[i];
+    }
+}
+
+TEST(JsonIndexTest, parse_error)
+{
+    const char *invalid[]={
+        "[1,]",
+        "{\"a\" 1}",
+        "[1 2]",
+        "{\"a\":1]",
+        "[\"open",
+        "[tru]",
+        "{1:2}",
+    };
+    for(size_t i=0; i<sizeof(invalid)/sizeof(invalid[0]); ++i){
+        std::vector<unsigned char> buffer;
+        auto p=refrange::msgpack::create_external_vector_packer(buffer);
+        refrange::text::json::indexed_parser parser(refrange::strrange(invalid[i]));
+        EXPECT_FALSE(parser.parse(p) && parser.is_end()) << invalid[i];
+    }
+}
+
+TEST(JsonIndexTest, too_large)
+{
+    if(sizeof(size_t)<=sizeof(unsigned int)){
+        return;
+    }
+    // the size is rejected before any byte is read
+    const unsigned char json[]="[1]";
+    refrange::immutable_range huge(json, json+UINT_MAX+static_cast<size_t>(1));
+
+    std::vector<unsigned int> index;
+    EXPECT_FALSE(refrange::text::json::build_structural_index(huge, index));
+    EXPECT_TRUE(index.empty());
+
+    std::vector<unsigned char> buffer;
+    auto p=refrange::msgpack::create_external_vector_packer(buffer);
+    refrange::text::json::indexed_parser parser(huge);
+    EXPECT_FALSE(parser.parse(p));
+    EXPECT_TRUE(buffer.empty());
+}
@@ -35,3 +35,196 @@ TEST(JsonTest, parse)
     }
 }
 
+
+static std::vector<unsigned char> parse_json(const std::string &json, size_t chunk_size)
+{
+    std::vector<unsigned char> buffer;
+    auto p=refrange::msgpack::create_external_vector_packer(buffer);
+    if(chunk_size==0){
+        // in place
+        refrange::text::json::parser parser(refrange::immutable_range(
+                    (const unsigned char*)json.c_str(), (const unsigned char*)json.c_str()+json.size()));
+        EXPECT_TRUE(parser.parse(p));
+        EXPECT_TRUE(parser.is_end());
+    }
+    else{
+        std::istringstream ss(json);
+        refrange::text::json::reader_t reader=[&ss](unsigned char *p, size_t len)->size_t{
+            ss.read((char*)p, len);
+            return static_cast<size_t>(ss.gcount());
+        };
+        refrange::text::json::parser parser(reader, chunk_size);
+        EXPECT_TRUE(parser.parse(p));
+        EXPECT_TRUE(parser.is_end());
+    }
+    return buffer;
+}
+
+TEST(JsonTest, parse_values) 
+{
+    const std::string json=
+        " {\"array\": [1, -2, -200, 3000000000, 1.5e3, -0.25, true, false, null, [], {}],\n"
+        "  \"escaped\": \"a\\\"b\\\\c\\n\\u00e9\\ud83d\\ude00\",\n"
+        "  \"long string that spans several chunks\": \"0123456789012345678901234567890123456789\"} ";
+
+    // whole buffer, tiny chunks and a middle size give the same msgpack
+    auto expected=parse_json(json, 0);
+    EXPECT_EQ(expected, parse_json(json, 1));
+    EXPECT_EQ(expected, parse_json(json, 7));
+
+    auto u=refrange::msgpack::create_unpacker(expected);
+    auto c=refrange::msgpack::map();
+    u >> c;
+    ASSERT_EQ(3, c.size);
+
+    std::string key;
+    u >> key;
+    EXPECT_EQ("array", key);
+    auto a=refrange::msgpack::array();
+    u >> a;
+    ASSERT_EQ(11, a.size);
+    int i;
+    u >> i;
+    EXPECT_EQ(1, i);
+    u >> i;
+    EXPECT_EQ(-2, i);
+    u >> i;
+    EXPECT_EQ(-200, i);
+    long long ll;
+    u >> ll;
+    EXPECT_EQ(3000000000LL, ll);
+    double d;
+    u >> d;
+    EXPECT_EQ(1500.0, d);
+    u >> d;
+    EXPECT_EQ(-0.25, d);
+    bool b;
+    u >> b;
+    EXPECT_TRUE(b);
+    u >> b;
+    EXPECT_FALSE(b);
+    EXPECT_TRUE(u.is_nil());
+    u.skip();
+    u >> a;
+    EXPECT_EQ(0, a.size);
+    u >> c;
+    EXPECT_EQ(0, c.size);
+
+    std::string s;
+    u >> key >> s;
+    EXPECT_EQ("escaped", key);
+    EXPECT_EQ("a\"b\\c\n\xc3\xa9\xf0\x9f\x98\x80", s);
+
+    u >> key >> s;
+    EXPECT_EQ("0123456789012345678901234567890123456789", s);
+    EXPECT_TRUE(u.range().is_end());
+}
+
+TEST(JsonTest, parse_error) 
+{
+    const char *invalid[]={
+        "[1,]",
+        "{\"a\" 1}",
+        "[01]",
+        "[1.]",
+        "\"\\x\"",
+        "\"\\udc00\"",
+        "tru",
+    };
+    for(size_t i=0; i<sizeof(invalid)/sizeof(invalid[0]); ++i){
+        std::string json=invalid[i];
+        std::vector<unsigned char> buffer;
+        auto p=refrange::msgpack::create_external_vector_packer(buffer);
+        refrange::text::json::parser parser(refrange::immutable_range(
+                    (const unsigned char*)json.c_str(), (const unsigned char*)json.c_str()+json.size()));
+        bool ok=false;
+        try{
+            ok=parser.parse(p) && parser.is_end();
+        }
+        catch(std::range_error &){
+        }
+        EXPECT_FALSE(ok) << json;
+    }
+}
+
+static std::string to_json(const std::vector<unsigned char> &buffer,
+        refrange::text::json::style_t style=refrange::text::json::style_compact, size_t buffer_size=16)
+{
+    std::string out;
+    refrange::text::json::writer_t writer=[&out](const unsigned char *p, size_t len)->size_t{
+        out.append((const char*)p, len);
+        return len;
+    };
+    refrange::text::json::converter converter(writer, style, buffer_size);
+    auto u=refrange::msgpack::create_unpacker(buffer);
+    converter.convert(u);
+    EXPECT_TRUE(u.range().is_end());
+    return out;
+}
+
+TEST(JsonTest, convert) 
+{
+    std::vector<unsigned char> buffer;
+    auto p=refrange::msgpack::create_external_vector_packer(buffer);
+    const unsigned char bin[]={0, 1, 2, 3, 0xff};
+    p.begin_collection(refrange::msgpack::map(8))
+        .pack_str("nil").pack_nil()
+        .pack_str("bool").pack_bool(false)
+        .pack_str("int").begin_collection(refrange::msgpack::array(4))
+            .pack_int(-1).pack_int(300).pack_int(-100000).pack_int(18446744073709551615ULL)
+        .pack_str("float").begin_collection(refrange::msgpack::array(4))
+            .pack_double(0.1).pack_float(1.5f).pack_float(0.1f).pack_double(std::numeric_limits<double>::infinity())
+        .pack_str("bin").pack_bin(bin, sizeof(bin))
+        .pack_str("ext").pack_ext(3, bin, 4)
+        .pack_int(7).pack_str("int key")
+        .pack_str("nested").begin_collection(refrange::msgpack::array(1))
+            .begin_collection(refrange::msgpack::map(1)).pack_str("a").pack_bool(true)
+        ;
+
+    EXPECT_EQ("{\"nil\":null,\"bool\":false,\"int\":[-1,300,-100000,18446744073709551615]"
+            ",\"float\":[0.1,1.5,0.1,null],\"bin\":\"AAECA/8=\",\"ext\":{\"type\":3,\"data\":\"AAECAw==\"}"
+            ",\"7\":\"int key\",\"nested\":[{\"a\":true}]}", to_json(buffer));
+
+    // back to the same msgpack except for the bin, ext and the key
+    std::string json="{\"a\":[1,-2,{\"b\":\"c\"},[],{}],\"d\":0.25,\"e\":null}";
+    EXPECT_EQ(json, to_json(parse_json(json, 0)));
+}
+
+TEST(JsonTest, convert_pretty) 
+{
+    auto buffer=parse_json("{\"a\":[1,{\"b\":true}],\"c\":{},\"d\":[]}", 0);
+    EXPECT_EQ(
+            "{\n"
+            "  \"a\": [\n"
+            "    1,\n"
+            "    {\n"
+            "      \"b\": true\n"
+            "    }\n"
+            "  ],\n"
+            "  \"c\": {},\n"
+            "  \"d\": []\n"
+            "}", to_json(buffer, refrange::text::json::style_pretty));
+}
+
+TEST(JsonTest, convert_escape) 
+{
+    // escapes at every position of the vector blocks
+    for(size_t i=0; i<70; ++i){
+        std::string s(i, 'x');
+        s+="\"\\\n\x01\xc3\xa9";
+        s+=std::string(70-i, 'y');
+
+        std::vector<unsigned char> buffer;
+        auto p=refrange::msgpack::create_external_vector_packer(buffer);
+        p.pack_str(s.c_str(), s.size());
+
+        auto expected="\""+std::string(i, 'x')+"\\\"\\\\\\n\\u0001\xc3\xa9"+std::string(70-i, 'y')+"\"";
+        EXPECT_EQ(expected, to_json(buffer));
+
+        std::string back;
+        auto parsed=parse_json(expected, 0);
+        auto u=refrange::msgpack::create_unpacker(parsed);
+        u >> back;
+        EXPECT_EQ(s, back);
+    }
+}
@@ -0,0 +1,113 @@
+#include <refrange/msgpack/keydict.h>
+#include <refrange/msgpack/utility.h>
+#include <gtest/gtest.h>
+
+
+TEST(KeyDictTest, ext)
+{
+    // packing
+    unsigned char data[]={1, 2, 3};
+    auto p=refrange::msgpack::create_vector_packer();
+    p.pack_ext(5, data, 1);
+    p.pack_ext(-1, data, 3);
+
+    // unpacking
+    auto u=refrange::msgpack::create_unpacker(p.pointer(), p.size());
+    signed char type;
+    refrange::immutable_range r;
+    auto buffer=refrange::msgpack::create_ext_view_buffer(type, r);
+
+    EXPECT_TRUE(u.is_ext());
+    u.unpack(buffer);
+    EXPECT_EQ(5, type);
+    ASSERT_EQ(1, r.size());
+    EXPECT_EQ(1, r.begin()[0]);
+
+    u.unpack(buffer);
+    EXPECT_EQ(-1, type);
+    ASSERT_EQ(3, r.size());
+    EXPECT_EQ(3, r.begin()[2]);
+
+    EXPECT_TRUE(u.range().is_end());
+}
+
+TEST(KeyDictTest, keys)
+{
+    // packing
+    refrange::msgpack::key_encoder encoder;
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::array(3);
+    for(int i=0; i<3; ++i){
+        p << refrange::msgpack::map(2);
+        encoder.pack_key(p, "timestamp") << i;
+        encoder.pack_key(p, "value") << "x";
+    }
+    EXPECT_EQ(2, encoder.size());
+
+    // unpacking
+    refrange::msgpack::key_decoder decoder;
+    auto u=refrange::msgpack::create_unpacker(p.pointer(), p.size());
+    auto c=refrange::msgpack::array();
+    u >> c;
+    ASSERT_EQ(3, c.size);
+    for(int i=0; i<3; ++i){
+        auto m=refrange::msgpack::map();
+        u >> m;
+        ASSERT_EQ(2, m.size);
+        std::string key;
+        int n;
+        decoder.unpack_key(u, key) >> n;
+        EXPECT_EQ("timestamp", key);
+        EXPECT_EQ(i, n);
+        refrange::immutable_range view;
+        std::string s;
+        decoder.unpack_key(u, view) >> s;
+        EXPECT_EQ("value", view.to_str());
+    }
+    EXPECT_TRUE(u.range().is_end());
+}
+
+TEST(KeyDictTest, transcode)
+{
+    // packing
+    auto plain=refrange::msgpack::create_vector_packer();
+    plain << refrange::msgpack::array(4);
+    for(int i=0; i<3; ++i){
+        plain << refrange::msgpack::map(2)
+            << "name" << "joint"
+            << "children" << refrange::msgpack::array(1) << refrange::msgpack::map(1) << "name" << i
+            ;
+    }
+    plain << refrange::msgpack::array(0);
+
+    // encode
+    refrange::msgpack::key_encoder encoder;
+    auto encoded=refrange::msgpack::create_vector_packer();
+    {
+        auto u=refrange::msgpack::create_unpacker(plain.pointer(), plain.size());
+        refrange::msgpack::encode_keys(u, encoded, encoder);
+    }
+    EXPECT_LT(encoded.size(), plain.size());
+
+    // decode
+    refrange::msgpack::key_decoder decoder;
+    auto decoded=refrange::msgpack::create_vector_packer();
+    {
+        auto u=refrange::msgpack::create_unpacker(encoded.pointer(), encoded.size());
+        refrange::msgpack::decode_keys(u, decoded, decoder);
+    }
+    ASSERT_EQ(plain.size(), decoded.size());
+    EXPECT_TRUE(std::equal(plain.pointer(), plain.pointer()+plain.size(), decoded.pointer()));
+}
+
+TEST(KeyDictTest, unknown_reference)
+{
+    unsigned char index=3;
+    auto p=refrange::msgpack::create_vector_packer();
+    p.pack_ext(refrange::msgpack::key_dictionary_ext_type, &index, 1);
+
+    refrange::msgpack::key_decoder decoder;
+    auto u=refrange::msgpack::create_unpacker(p.pointer(), p.size());
+    refrange::immutable_range key;
+    EXPECT_THROW(decoder.unpack_key(u, key), refrange::msgpack::unpack_error);
+}
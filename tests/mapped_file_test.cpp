@@ -0,0 +1,62 @@
+#include <refrange/mapped_file.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+
+static std::string temp_dir()
+{
+#ifdef _WIN32
+    auto dir=getenv("TEMP");
+    return std::string(dir ? dir : ".")+"\\";
+#else
+    auto dir=getenv("TMPDIR");
+    return std::string(dir && *dir ? dir : "/tmp")+"/";
+#endif
+}
+
+
+static std::string write_temp(const std::string &name, const std::string &content)
+{
+    auto path=temp_dir()+name;
+    auto fp=fopen(path.c_str(), "wb");
+    fwrite(content.data(), 1, content.size(), fp);
+    fclose(fp);
+    return path;
+}
+
+
+TEST(MappedFileTest, map)
+{
+    auto path=write_temp("mapped_file_test.txt", "HIERARCHY\nROOT Hips\n");
+
+    refrange::mapped_file file(path.c_str());
+    ASSERT_TRUE(file.is_open());
+    EXPECT_EQ(20, file.size());
+    EXPECT_EQ(refrange::strrange("HIERARCHY\nROOT Hips\n"), file.range());
+    EXPECT_TRUE(file.range()==refrange::vectorrange(refrange::readfile(path.c_str())));
+
+    // move only
+    refrange::mapped_file moved(std::move(file));
+    EXPECT_FALSE(file.is_open());
+    EXPECT_EQ(0, file.size());
+    EXPECT_EQ(20, moved.size());
+
+    moved.close();
+    EXPECT_FALSE(moved.is_open());
+    remove(path.c_str());
+}
+
+TEST(MappedFileTest, empty)
+{
+    auto path=write_temp("mapped_file_empty.txt", "");
+    refrange::mapped_file file(path.c_str(), refrange::map_random);
+    EXPECT_TRUE(file.is_open());
+    EXPECT_EQ(0, file.size());
+    EXPECT_FALSE(file.range());
+    remove(path.c_str());
+
+    refrange::mapped_file missing("no/such/file");
+    EXPECT_FALSE(missing.is_open());
+}
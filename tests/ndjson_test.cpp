@@ -0,0 +1,118 @@
+#include <refrange/text/ndjson.h>
+#include <gtest/gtest.h>
+#include <sstream>
+
+
+static refrange::immutable_range to_range(const std::string &s)
+{
+    return refrange::immutable_range((const unsigned char*)s.c_str(), (const unsigned char*)s.c_str()+s.size());
+}
+
+static refrange::immutable_range to_range(const std::vector<unsigned char> &v)
+{
+    return refrange::immutable_range(&v[0], &v[0]+v.size());
+}
+
+static std::string make_lines(size_t count)
+{
+    std::ostringstream ss;
+    for(size_t i=0; i<count; ++i){
+        ss << "{\"id\":" << i << ",\"name\":\"item" << i << "\",\"values\":[" << i*0.5 << ",true,null]}\n";
+    }
+    return ss.str();
+}
+
+
+TEST(NdjsonTest, split_lines)
+{
+    std::string src="a\nbb\nccc\n\ndddd";
+    auto chunks=refrange::text::ndjson::split_lines(to_range(src), 3);
+    ASSERT_EQ(3, chunks.size());
+    EXPECT_EQ("a\nbb\n", std::string(chunks[0].begin(), chunks[0].end()));
+    EXPECT_EQ("ccc\n", std::string(chunks[1].begin(), chunks[1].end()));
+    EXPECT_EQ("\ndddd", std::string(chunks[2].begin(), chunks[2].end()));
+}
+
+TEST(NdjsonTest, round_trip)
+{
+    refrange::thread_pool pool(4);
+    auto src=make_lines(1000);
+
+    // blank lines and CRLF
+    auto input="\n"+src+"\r\n  \n";
+
+    // the same stream with any chunk size
+    auto packed=refrange::text::ndjson::to_msgpack(pool, to_range(input), 97);
+    EXPECT_EQ(packed, refrange::text::ndjson::to_msgpack(pool, to_range(input), 1<<20));
+
+    size_t messages=0;
+    refrange::msgpack::unpacker u(&packed[0], &packed[0]+packed.size());
+    while(!u.range().is_end()){
+        u.skip();
+        ++messages;
+    }
+    EXPECT_EQ(1000, messages);
+
+    auto json=refrange::text::ndjson::to_ndjson(pool, to_range(packed), 101);
+    EXPECT_EQ(src, std::string(json.begin(), json.end()));
+}
+
+TEST(NdjsonTest, streaming)
+{
+    refrange::thread_pool pool(3);
+    auto src=make_lines(500);
+
+    // a few bytes at a time
+    std::istringstream in(src);
+    refrange::text::json::reader_t reader=[&in](unsigned char *p, size_t len)->size_t{
+        in.read((char*)p, std::min<size_t>(len, 33));
+        return static_cast<size_t>(in.gcount());
+    };
+    std::vector<unsigned char> packed;
+    refrange::text::json::writer_t writer=[&packed](const unsigned char *p, size_t len)->size_t{
+        packed.insert(packed.end(), p, p+len);
+        return len;
+    };
+    // lines are longer than the window
+    refrange::text::ndjson::to_msgpack(pool, reader, writer, 10);
+    EXPECT_EQ(refrange::text::ndjson::to_msgpack(pool, to_range(src)), packed);
+
+    size_t pos=0;
+    refrange::text::json::reader_t packed_reader=[&packed, &pos](unsigned char *p, size_t len)->size_t{
+        len=std::min<size_t>(len, std::min<size_t>(packed.size()-pos, 29));
+        std::copy(packed.begin()+pos, packed.begin()+pos+len, p);
+        pos+=len;
+        return len;
+    };
+    std::string json;
+    refrange::text::json::writer_t json_writer=[&json](const unsigned char *p, size_t len)->size_t{
+        json.append((const char*)p, len);
+        return len;
+    };
+    refrange::text::ndjson::to_ndjson(pool, packed_reader, json_writer, 64);
+    EXPECT_EQ(src, json);
+}
+
+TEST(NdjsonTest, error_line)
+{
+    refrange::thread_pool pool(2);
+    auto src=make_lines(300);
+    // line 201 has two values
+    auto pos=src.find("{\"id\":200,");
+    src.insert(pos, "1 ");
+    try{
+        refrange::text::ndjson::to_msgpack(pool, to_range(src), 64);
+        FAIL();
+    }
+    catch(const refrange::text::ndjson::parse_error &e){
+        EXPECT_EQ(201, e.line);
+    }
+
+    std::string multiline="[1,\n2]\n";
+    EXPECT_THROW(refrange::text::ndjson::to_msgpack(pool, to_range(multiline)), refrange::text::ndjson::parse_error);
+
+    // truncated msgpack
+    auto packed=refrange::text::ndjson::to_msgpack(pool, to_range(make_lines(3)));
+    packed.pop_back();
+    EXPECT_THROW(refrange::text::ndjson::to_ndjson(pool, to_range(packed)), std::range_error);
+}
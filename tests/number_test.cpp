@@ -0,0 +1,259 @@
+#include <refrange/text/number.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <random>
+
+
+static double parse(const std::string &s)
+{
+    double d=0;
+    // overflow still gives the infinity
+    auto result=refrange::text::parse_double(s.c_str(), s.c_str()+s.size(), d);
+    EXPECT_NE(refrange::text::number_invalid, result.status) << s;
+    EXPECT_EQ(s.size(), result.consumed) << s;
+    return d;
+}
+
+static bool same_bits(double a, double b)
+{
+    return memcmp(&a, &b, sizeof(double))==0;
+}
+
+static std::string format(double d)
+{
+    char buf[refrange::text::max_number_chars];
+    return std::string(buf, refrange::text::format_double(buf, d));
+}
+
+
+TEST(NumberTest, parse_double)
+{
+    const char *cases[]={
+        "0", "-0", "1", "0.1", "0.5", "3.14159", "1e10", "1E-10", "-2.5e+3",
+        "123456789012345678", "1234567890123456789012345678901234567890",
+        "9007199254740993", "9007199254740992.5",
+        "1e23", "8.98846567431158e307", "1.7976931348623157e308",
+        "2.2250738585072011e-308", "2.2250738585072014e-308",
+        "4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324",
+        "1e-400", "0.000000000000000000000000000000000000001",
+        "7.038531e-26", "3.4e38", "1.00000000000000011102230246251565404236316680908203125",
+        "1.00000000000000011102230246251565404236316680908203124",
+        "1.00000000000000011102230246251565404236316680908203126",
+        "123.456e-78", "0.1e1", "100000000000000000000000000000000000000000000000000e-50",
+    };
+    for(size_t i=0; i<sizeof(cases)/sizeof(cases[0]); ++i){
+        auto expected=strtod(cases[i], 0);
+        EXPECT_TRUE(same_bits(expected, parse(cases[i]))) << cases[i];
+    }
+
+    std::mt19937_64 rng(1);
+    char buf[64];
+    for(int i=0; i<20000; ++i){
+        // random digits and exponents
+        int digits=1+rng()%25;
+        std::string s;
+        for(int j=0; j<digits; ++j){
+            s+=static_cast<char>('0'+rng()%10);
+        }
+        while(s.size()>1 && s[0]=='0'){
+            s.erase(0, 1);
+        }
+        if(rng()%2){
+            auto pos=1+rng()%s.size();
+            if(pos<s.size()){
+                s.insert(pos, ".");
+            }
+        }
+        sprintf(buf, "e%d", static_cast<int>(rng()%700)-350);
+        s+=buf;
+        EXPECT_TRUE(same_bits(strtod(s.c_str(), 0), parse(s))) << s;
+    }
+}
+
+TEST(NumberTest, parse_invalid)
+{
+    // json
+    const char *cases[]={
+        "", "-", "01", "1.", ".5", "1e", "1e+", "+1", "1x", "--1",
+    };
+    for(size_t i=0; i<sizeof(cases)/sizeof(cases[0]); ++i){
+        auto end=cases[i]+strlen(cases[i]);
+        refrange::text::number_parts parts;
+        EXPECT_NE(end, refrange::text::scan_number(cases[i], end, parts)) << cases[i];
+    }
+
+    // text
+    const char *text_cases[]={
+        "", "-", "+", ".", "-.", "e1", "x1", "--1",
+    };
+    for(size_t i=0; i<sizeof(text_cases)/sizeof(text_cases[0]); ++i){
+        double d=0;
+        auto result=refrange::text::parse_double(text_cases[i], text_cases[i]+strlen(text_cases[i]), d);
+        EXPECT_EQ(refrange::text::number_invalid, result.status) << text_cases[i];
+        EXPECT_EQ(0, result.consumed);
+    }
+
+    double d;
+    const char *large="1e400";
+    EXPECT_EQ(refrange::text::number_overflow, refrange::text::parse_double(large, large+5, d).status);
+}
+
+static size_t consumed_double(const char *s, double expected)
+{
+    double d=0;
+    auto result=refrange::text::parse_double(s, s+strlen(s), d);
+    EXPECT_EQ(refrange::text::number_ok, result.status) << s;
+    EXPECT_TRUE(same_bits(expected, d)) << s;
+    return result.consumed;
+}
+
+TEST(NumberTest, parse_bounded)
+{
+    // the head of the text
+    EXPECT_EQ(3, consumed_double("1.5,2.0", 1.5));
+    EXPECT_EQ(2, consumed_double("1.", 1.0));
+    EXPECT_EQ(2, consumed_double(".5", 0.5));
+    EXPECT_EQ(3, consumed_double("+07", 7.0));
+    EXPECT_EQ(1, consumed_double("1e", 1.0));
+    EXPECT_EQ(1, consumed_double("1e+x", 1.0));
+    EXPECT_EQ(7, consumed_double("-1.5E-2;", -0.015));
+
+    // never reads past the end
+    const char digits[]="123456789";
+    double d=0;
+    auto result=refrange::text::parse_double(digits, digits+4, d);
+    EXPECT_EQ(4, result.consumed);
+    EXPECT_EQ(1234.0, d);
+
+    float f=0;
+    const char *text="0.1 ";
+    result=refrange::text::parse_float(text, text+4, f);
+    EXPECT_EQ(3, result.consumed);
+    EXPECT_EQ(0.1f, f);
+
+    // floats match strtof
+    std::mt19937_64 rng(2);
+    char buf[64];
+    for(int i=0; i<20000; ++i){
+        auto n=static_cast<int>(rng()%100000000);
+        sprintf(buf, "%s%d.%de%d", rng()%2 ? "-" : "", n/1000, n%1000, static_cast<int>(rng()%20)-10);
+        f=0;
+        ASSERT_EQ(refrange::text::number_ok, refrange::text::parse_float(buf, buf+strlen(buf), f).status) << buf;
+        EXPECT_EQ(strtof(buf, 0), f) << buf;
+    }
+}
+
+TEST(NumberTest, parse_int)
+{
+    long long n=0;
+    const char *max="9223372036854775807";
+    auto result=refrange::text::parse_int64(max, max+strlen(max), n);
+    EXPECT_EQ(refrange::text::number_ok, result.status);
+    EXPECT_EQ(19, result.consumed);
+    EXPECT_EQ(std::numeric_limits<long long>::max(), n);
+
+    const char *min="-9223372036854775808";
+    EXPECT_EQ(refrange::text::number_ok, refrange::text::parse_int64(min, min+strlen(min), n).status);
+    EXPECT_EQ(std::numeric_limits<long long>::min(), n);
+
+    const char *over="9223372036854775808";
+    EXPECT_EQ(refrange::text::number_overflow, refrange::text::parse_int64(over, over+strlen(over), n).status);
+    EXPECT_EQ(std::numeric_limits<long long>::max(), n);
+
+    // leading zeros do not overflow
+    const char *zeros="+000000000000000000000012x";
+    result=refrange::text::parse_int64(zeros, zeros+strlen(zeros), n);
+    EXPECT_EQ(refrange::text::number_ok, result.status);
+    EXPECT_EQ(25, result.consumed);
+    EXPECT_EQ(12, n);
+
+    int i=0;
+    const char *big="2147483648";
+    EXPECT_EQ(refrange::text::number_overflow, refrange::text::parse_int32(big, big+strlen(big), i).status);
+    EXPECT_EQ(std::numeric_limits<int>::max(), i);
+    const char *small="-2147483648 ";
+    result=refrange::text::parse_int32(small, small+strlen(small), i);
+    EXPECT_EQ(11, result.consumed);
+    EXPECT_EQ(std::numeric_limits<int>::min(), i);
+
+    // stops at the fraction
+    const char *frac="12.5";
+    EXPECT_EQ(2, refrange::text::parse_int32(frac, frac+4, i).consumed);
+    EXPECT_EQ(12, i);
+
+    i=5;
+    const char *invalid="-x";
+    EXPECT_EQ(refrange::text::number_invalid, refrange::text::parse_int32(invalid, invalid+2, i).status);
+    EXPECT_EQ(5, i);
+}
+
+TEST(NumberTest, format_double)
+{
+    EXPECT_EQ("0.0", format(0));
+    EXPECT_EQ("-0.0", format(-0.0));
+    EXPECT_EQ("1.0", format(1));
+    EXPECT_EQ("0.1", format(0.1));
+    EXPECT_EQ("-2.5", format(-2.5));
+    EXPECT_EQ("0.30000000000000004", format(0.1+0.2));
+    EXPECT_EQ("1e+300", format(1e300));
+    EXPECT_EQ("1.5e-07", format(1.5e-7));
+    EXPECT_EQ("123456789.0", format(123456789));
+    EXPECT_EQ("1.7976931348623157e+308", format(1.7976931348623157e308));
+    EXPECT_EQ("5e-324", format(4.9406564584124654e-324));
+    // grisu2 gives -4.4188400362109824e+16
+    EXPECT_EQ("-4.418840036210982e+16", format(-4.4188400362109824e+16));
+    EXPECT_EQ("NaN", format(std::numeric_limits<double>::quiet_NaN()));
+    EXPECT_EQ("-Infinity", format(-std::numeric_limits<double>::infinity()));
+
+    // round trip
+    std::mt19937_64 rng(2);
+    for(int i=0; i<20000; ++i){
+        unsigned long long bits=rng();
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        if(d!=d || d==std::numeric_limits<double>::infinity() || d==-std::numeric_limits<double>::infinity()){
+            continue;
+        }
+        auto s=format(d);
+        EXPECT_TRUE(same_bits(d, parse(s))) << s;
+    }
+}
+
+TEST(NumberTest, format_float)
+{
+    char buf[refrange::text::max_number_chars];
+    EXPECT_EQ("0.1", std::string(buf, refrange::text::format_float(buf, 0.1f)));
+    EXPECT_EQ("-1.5", std::string(buf, refrange::text::format_float(buf, -1.5f)));
+    EXPECT_EQ("3.4028235e+38", std::string(buf, refrange::text::format_float(buf, 3.4028235e38f)));
+    EXPECT_EQ("1e-45", std::string(buf, refrange::text::format_float(buf, 1.4e-45f)));
+    EXPECT_EQ("16777216.0", std::string(buf, refrange::text::format_float(buf, 16777216.0f)));
+
+    // round trip in float
+    std::mt19937 rng(3);
+    for(int i=0; i<20000; ++i){
+        unsigned int bits=rng();
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        if(f!=f || f==std::numeric_limits<float>::infinity() || f==-std::numeric_limits<float>::infinity()){
+            continue;
+        }
+        auto end=refrange::text::format_float(buf, f);
+        float back;
+        refrange::text::parse_float(buf, end, back);
+        EXPECT_EQ(0, memcmp(&f, &back, sizeof(f))) << std::string(buf, end);
+    }
+}
+
+TEST(NumberTest, format_int)
+{
+    char buf[refrange::text::max_number_chars];
+    EXPECT_EQ("0", std::string(buf, refrange::text::format_int(buf, 0)));
+    EXPECT_EQ("7", std::string(buf, refrange::text::format_int(buf, 7)));
+    EXPECT_EQ("-42", std::string(buf, refrange::text::format_int(buf, -42)));
+    EXPECT_EQ("1234567890", std::string(buf, refrange::text::format_int(buf, 1234567890)));
+    EXPECT_EQ("-9223372036854775808", std::string(buf, refrange::text::format_int(buf, -9223372036854775807LL-1)));
+    EXPECT_EQ("18446744073709551615", std::string(buf, refrange::text::format_uint(buf, 18446744073709551615ULL)));
+}
@@ -0,0 +1,95 @@
+#include <refrange/msgpack/parallel.h>
+#include <refrange/msgpack/utility.h>
+#include <gtest/gtest.h>
+#include <atomic>
+
+
+TEST(ParallelTest, skip_value)
+{
+    // packing
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::map(2)
+        << "key" << refrange::msgpack::array(2) << 1 << "str"
+        << "other" << 1.5f
+        ;
+    p << 2;
+
+    auto end=refrange::msgpack::skip_value(p.pointer(), p.pointer()+p.size());
+    EXPECT_EQ(p.pointer()+p.size()-1, end);
+
+    // truncated
+    EXPECT_THROW(refrange::msgpack::skip_value(p.pointer(), p.pointer()+p.size()-4)
+            , std::range_error);
+}
+
+TEST(ParallelTest, skip_ext)
+{
+    const unsigned char packed[]={
+        // fixext 1, fixext 16
+        0xd4, 0x01, 0xaa,
+        0xd8, 0x01, 0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,
+        // ext 8 of 2 bytes, empty ext 16 and ext 32
+        0xc7, 0x02, 0x01, 0xaa, 0xbb,
+        0xc8, 0x00, 0x00, 0x01,
+        0xc9, 0x00, 0x00, 0x00, 0x00, 0x01,
+    };
+    const size_t sizes[]={ 3, 18, 5, 4, 6 };
+    auto p=packed;
+    auto end=packed+sizeof(packed);
+    for(size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); ++i){
+        auto next=refrange::msgpack::skip_value(p, end);
+        EXPECT_EQ(sizes[i], next-p);
+        p=next;
+    }
+    EXPECT_EQ(end, p);
+
+    // truncated in the data
+    EXPECT_THROW(refrange::msgpack::skip_value(packed+21, packed+25), std::range_error);
+    EXPECT_THROW(refrange::msgpack::skip_value(packed+3, packed+20), std::range_error);
+}
+
+TEST(ParallelTest, unpack)
+{
+    // packing
+    auto p=refrange::msgpack::create_vector_packer();
+    auto c=refrange::msgpack::array(1000);
+    p << c;
+    for(size_t i=0; i<c.size; ++i){
+        p << static_cast<int>(i*3);
+    }
+
+    refrange::thread_pool pool(4);
+    auto values=refrange::msgpack::parallel_unpack<int>(pool,
+            refrange::immutable_range(p.pointer(), p.pointer()+p.size()));
+
+    ASSERT_EQ(c.size, values.size());
+    for(size_t i=0; i<values.size(); ++i){
+        EXPECT_EQ(i*3, values[i]);
+    }
+}
+
+TEST(ParallelTest, visit)
+{
+    // packing
+    auto p=refrange::msgpack::create_vector_packer();
+    auto c=refrange::msgpack::array(100);
+    p << c;
+    for(size_t i=0; i<c.size; ++i){
+        p << refrange::msgpack::map(1) << "value" << static_cast<int>(i);
+    }
+
+    refrange::thread_pool pool(4);
+    std::atomic<int> sum(0);
+    refrange::msgpack::parallel_visit(pool,
+            refrange::immutable_range(p.pointer(), p.pointer()+p.size()),
+            [&sum](size_t index, refrange::msgpack::unpacker &u){
+                auto m=refrange::msgpack::map();
+                std::string key;
+                int value;
+                u >> m >> key >> value;
+                EXPECT_EQ(index, value);
+                sum+=value;
+            });
+
+    EXPECT_EQ(99*100/2, sum);
+}
@@ -1,6 +1,7 @@
 #include <refrange/binary/pmx.h>
 #include <refrange/binary/pmd.h>
 #include <gtest/gtest.h>
+#include <vector>
 
 
 TEST(PmxTest, pmx) 
@@ -30,6 +31,87 @@ TEST(PmxTest, pmx)
 	return;
 }
 
+template<typename T>
+static void push(std::vector<unsigned char> &buf, const T &value)
+{
+    buf.insert(buf.end(), (const unsigned char*)&value, (const unsigned char*)&value+sizeof(T));
+}
+
+static std::vector<unsigned char> create_pmx(unsigned char index_size)
+{
+    std::vector<unsigned char> buf;
+    buf.insert(buf.end(), "PMX ", "PMX "+4);
+    push(buf, 2.0f);
+    push(buf, (unsigned char)8);
+    // utf16, no additional uv, vertex index, texture, material, bone 2 bytes, morph, rigidbody
+    unsigned char flags[]={ 0, 0, index_size, 1, 1, 2, 1, 1 };
+    buf.insert(buf.end(), flags, flags+8);
+    for(int i=0; i<4; ++i){
+        push(buf, 0);
+    }
+
+    // BDEF1, BDEF4 and SDEF
+    push(buf, 3);
+    for(unsigned char deform=0; deform<4; deform+=deform==0 ? 2 : 1){
+        float head[8]={ static_cast<float>(deform), 1, 2, 0, 1, 0, 0.5f, 0.5f };
+        push(buf, head);
+        push(buf, deform);
+        int bones=deform==2 ? 4 : deform==3 ? 2 : 1;
+        for(int i=0; i<bones; ++i){
+            push(buf, (short)i);
+        }
+        int floats=deform==2 ? 4 : deform==3 ? 1+9 : 0;
+        for(int i=0; i<floats; ++i){
+            push(buf, 0.25f);
+        }
+        // edge
+        push(buf, 1.5f);
+    }
+
+    push(buf, 3);
+    for(int i=0; i<3; ++i){
+        switch(index_size)
+        {
+            case 1: push(buf, (unsigned char)(2-i)); break;
+            case 2: push(buf, (unsigned short)(2-i)); break;
+            case 4: push(buf, (unsigned int)(2-i)); break;
+        }
+    }
+
+    // textures, materials, bones, morphs, groups, rigidbodies, joints
+    for(int i=0; i<7; ++i){
+        push(buf, 0);
+    }
+    return buf;
+}
+
+TEST(PmxTest, vertices)
+{
+    unsigned char index_sizes[]={ 1, 2, 4 };
+    for(int i=0; i<3; ++i){
+        auto buf=create_pmx(index_sizes[i]);
+        refrange::binary::pmx::loader pmx;
+        ASSERT_TRUE(pmx.load(refrange::vectorrange(buf)));
+
+        auto &vertices=pmx.get_vertices();
+        ASSERT_EQ(3, vertices.size());
+        EXPECT_EQ(2.0f, vertices[1].pos.x);
+        EXPECT_EQ(3.0f, vertices[2].pos.x);
+        EXPECT_EQ(0.5f, vertices[2].texcoords.y);
+        EXPECT_EQ(1.5f, vertices[2].edge_factor);
+
+        auto &indices=pmx.get_indices();
+        ASSERT_EQ(3, indices.size());
+        EXPECT_EQ(2, indices[0]);
+        EXPECT_EQ(0, indices[2]);
+
+        // a truncated vertex
+        buf.resize(buf.size()-30-3*index_sizes[i]-4);
+        refrange::binary::pmx::loader truncated;
+        EXPECT_THROW(truncated.load(refrange::vectorrange(buf)), std::range_error);
+    }
+}
+
 TEST(PmdTest, pmd) 
 {
 	auto path = SAMPLES_DIR "/miku_v2.pmd";
@@ -0,0 +1,94 @@
+#include <refrange/msgpack/pointer.h>
+#include <refrange/msgpack/utility.h>
+#include <gtest/gtest.h>
+
+
+static refrange::msgpack::packer pack_model()
+{
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::map(3)
+        << "name" << "model"
+        << "bones" << refrange::msgpack::array(3)
+            << refrange::msgpack::map(2) << "name" << "root" << "parent" << -1
+            << refrange::msgpack::map(2) << "name" << "arm" << "parent" << 0
+            << refrange::msgpack::map(2) << "name" << "hand" << "parent" << 1
+        << "a/b~c" << refrange::msgpack::map(1) << "0" << true
+        ;
+    return p;
+}
+
+static std::string to_string(const refrange::immutable_range &value)
+{
+    auto u=refrange::msgpack::create_unpacker(value.begin(), value.size());
+    std::string s;
+    u >> s;
+    return s;
+}
+
+
+TEST(PointerTest, compile)
+{
+    auto ptr=refrange::msgpack::pointer::compile("/bones/2/name");
+    ASSERT_EQ(3, ptr.size());
+    EXPECT_EQ("bones", ptr.key(0));
+    EXPECT_EQ("2", ptr.key(1));
+
+    auto escaped=refrange::msgpack::pointer::compile("/a~1b~0c/");
+    ASSERT_EQ(2, escaped.size());
+    EXPECT_EQ("a/b~c", escaped.key(0));
+    EXPECT_EQ("", escaped.key(1));
+
+    auto dotted=refrange::msgpack::pointer::compile_dotted("bones[2].name");
+    ASSERT_EQ(3, dotted.size());
+    EXPECT_EQ("2", dotted.key(1));
+
+    EXPECT_THROW(refrange::msgpack::pointer::compile("bones"), refrange::msgpack::pointer_error);
+    EXPECT_THROW(refrange::msgpack::pointer::compile("/a~2"), refrange::msgpack::pointer_error);
+    EXPECT_THROW(refrange::msgpack::pointer::compile_dotted("a[x]"), refrange::msgpack::pointer_error);
+    EXPECT_THROW(refrange::msgpack::pointer::compile_dotted("a..b"), refrange::msgpack::pointer_error);
+    EXPECT_THROW(refrange::msgpack::pointer::compile_dotted("a."), refrange::msgpack::pointer_error);
+    EXPECT_THROW(refrange::msgpack::pointer::compile_dotted("a[0]."), refrange::msgpack::pointer_error);
+}
+
+TEST(PointerTest, resolve)
+{
+    auto p=pack_model();
+    refrange::immutable_range packed(p.pointer(), p.pointer()+p.size());
+
+    refrange::immutable_range value;
+    ASSERT_TRUE(refrange::msgpack::pointer::compile("/bones/2/name").resolve(packed, value));
+    EXPECT_EQ("hand", to_string(value));
+
+    ASSERT_TRUE(refrange::msgpack::pointer::compile_dotted("bones.1.name").resolve(packed, value));
+    EXPECT_EQ("arm", to_string(value));
+
+    // a view of the packed value
+    ASSERT_TRUE(refrange::msgpack::resolve(packed, "/bones/0", value));
+    EXPECT_EQ(refrange::msgpack::skip_value(value.begin(), packed.end()), value.end());
+    {
+        auto u=refrange::msgpack::create_unpacker(value.begin(), value.size());
+        auto c=refrange::msgpack::map();
+        u >> c;
+        EXPECT_EQ(2, c.size);
+    }
+
+    // a numeric token is a key for a map
+    ASSERT_TRUE(refrange::msgpack::resolve(packed, "/a~1b~0c/0", value));
+    {
+        auto u=refrange::msgpack::create_unpacker(value.begin(), value.size());
+        bool b=false;
+        u >> b;
+        EXPECT_TRUE(b);
+    }
+
+    // the whole value
+    ASSERT_TRUE(refrange::msgpack::resolve(packed, "", value));
+    EXPECT_EQ(packed.size(), value.size());
+
+    EXPECT_FALSE(refrange::msgpack::resolve(packed, "/bones/3", value));
+    EXPECT_FALSE(refrange::msgpack::resolve(packed, "/bones/-", value));
+    EXPECT_FALSE(refrange::msgpack::resolve(packed, "/bones/name", value));
+    EXPECT_FALSE(refrange::msgpack::resolve(packed, "/name/0", value));
+    EXPECT_FALSE(refrange::msgpack::resolve(packed, "/missing", value));
+    EXPECT_TRUE(refrange::msgpack::pointer::compile("/missing").find(packed).begin()==0);
+}
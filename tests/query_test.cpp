@@ -0,0 +1,135 @@
+#include <refrange/msgpack/query.h>
+#include <refrange/msgpack/utility.h>
+#include <gtest/gtest.h>
+
+
+static refrange::msgpack::packer pack_records()
+{
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::map(2)
+        << "name" << "log"
+        << "records" << refrange::msgpack::array(3)
+            << refrange::msgpack::map(3) << "level" << "info" << "time" << 1 << "message" << "a"
+            << refrange::msgpack::map(3) << "level" << "error" << "time" << 2 << "message" << "b"
+            << refrange::msgpack::map(3) << "level" << "error" << "time" << 3 << "message" << "c"
+            ;
+    return p;
+}
+
+
+TEST(QueryTest, path)
+{
+    auto p=pack_records();
+    auto q=refrange::msgpack::query::compile(".records[1].message");
+
+    std::vector<std::string> found;
+    q.match(refrange::immutable_range(p.pointer(), p.pointer()+p.size()),
+            [&found](const refrange::immutable_range &value){
+                auto u=refrange::msgpack::create_unpacker(value.begin(), value.size());
+                std::string s;
+                u >> s;
+                found.push_back(s);
+            });
+
+    ASSERT_EQ(1, found.size());
+    EXPECT_EQ("b", found[0]);
+}
+
+TEST(QueryTest, filter)
+{
+    auto p=pack_records();
+    auto q=refrange::msgpack::query::compile(".records[*][?.level==\"error\"][?.time>=3].time");
+
+    std::vector<int> found;
+    q.match(refrange::immutable_range(p.pointer(), p.pointer()+p.size()),
+            [&found](const refrange::immutable_range &value){
+                auto u=refrange::msgpack::create_unpacker(value.begin(), value.size());
+                int n;
+                u >> n;
+                found.push_back(n);
+            });
+
+    ASSERT_EQ(1, found.size());
+    EXPECT_EQ(3, found[0]);
+}
+
+TEST(QueryTest, projection)
+{
+    auto p=pack_records();
+    auto q=refrange::msgpack::query::compile(".records.*[?.level!=\"info\"]{time, message}");
+
+    auto out=refrange::msgpack::create_vector_packer();
+    auto count=q.select(refrange::immutable_range(p.pointer(), p.pointer()+p.size()), out);
+    EXPECT_EQ(2, count);
+
+    auto u=refrange::msgpack::create_unpacker(out.pointer(), out.size());
+    for(int i=0; i<2; ++i){
+        auto c=refrange::msgpack::map();
+        std::string key;
+        int time;
+        std::string message;
+        u >> c;
+        EXPECT_EQ(2, c.size);
+        u >> key >> time;
+        EXPECT_EQ("time", key);
+        EXPECT_EQ(i+2, time);
+        u >> key >> message;
+        EXPECT_EQ("message", key);
+    }
+    EXPECT_TRUE(u.range().is_end());
+
+    // not a map
+    auto times=refrange::msgpack::query::compile(".records.*.time{time}");
+    auto nils=refrange::msgpack::create_vector_packer();
+    EXPECT_EQ(3, times.select(refrange::immutable_range(p.pointer(), p.pointer()+p.size()), nils));
+    auto n=refrange::msgpack::create_unpacker(nils.pointer(), nils.size());
+    for(int i=0; i<3; ++i){
+        EXPECT_TRUE(n.is_nil());
+        n.skip();
+    }
+    EXPECT_TRUE(n.range().is_end());
+}
+
+TEST(QueryTest, syntax_error)
+{
+    EXPECT_THROW(refrange::msgpack::query::compile(".records[1"),
+            refrange::msgpack::query::query_error);
+    EXPECT_THROW(refrange::msgpack::query::compile("[?.a~1]"),
+            refrange::msgpack::query::query_error);
+    EXPECT_THROW(refrange::msgpack::query::compile("[?.a==1-2]"),
+            refrange::msgpack::query::query_error);
+    EXPECT_THROW(refrange::msgpack::query::compile("[?.a==1.5.5]"),
+            refrange::msgpack::query::query_error);
+}
+
+TEST(QueryTest, truncated)
+{
+    auto match=[](const char *query, const std::vector<unsigned char> &packed){
+        // exact size so that a read past the end is caught by the sanitizers
+        auto q=refrange::msgpack::query::compile(query);
+        size_t count=0;
+        q.match(refrange::immutable_range(packed.data(), packed.data()+packed.size()),
+                [&count](const refrange::immutable_range &){ ++count; });
+        return count;
+    };
+
+    // {"abc": ...} cut in the key
+    std::vector<unsigned char> key{ 0x81, 0xa3, 'a', 'b' };
+    EXPECT_THROW(match(".abc", key), std::range_error);
+    EXPECT_THROW(match(".*", key), std::range_error);
+
+    // {"a": ...} without the value
+    std::vector<unsigned char> value{ 0x81, 0xa1, 'a' };
+    EXPECT_THROW(match(".a", value), std::range_error);
+    EXPECT_THROW(match(".b", value), std::range_error);
+
+    // [1, ...] without the second element
+    std::vector<unsigned char> element{ 0x92, 0x01 };
+    EXPECT_THROW(match("[1]", element), std::range_error);
+    EXPECT_THROW(match(".*", element), std::range_error);
+    EXPECT_EQ(1, match("[0]", element));
+
+    // nothing at all
+    std::vector<unsigned char> empty;
+    EXPECT_THROW(match(".a", empty), std::range_error);
+}
@@ -68,5 +68,102 @@ TEST(TextTest, text)
     EXPECT_EQ(-1, refrange::strrange("-1").to_int());
 
     EXPECT_EQ(1.5, refrange::strrange("1.5").to_double());
+
+    // bounded by the range. no '\0' needed.
+    auto digits=refrange::strrange("12345");
+    EXPECT_EQ(12, refrange::immutable_range(digits.begin(), digits.begin()+2).to_int());
+    EXPECT_EQ(123.0, refrange::immutable_range(digits.begin(), digits.begin()+3).to_double());
+    EXPECT_EQ(0.25f, refrange::strrange(" 0.25;").to_float());
+    EXPECT_EQ(0, refrange::strrange("x1").to_int());
+}
+
+
+TEST(RangeTest, tokens) 
+{
+    auto range=refrange::strrange("  OFFSET 1.0\t-2.5  3 ");
+    auto tokens=range.tokens();
+    auto it=tokens.begin();
+    ASSERT_TRUE(it!=tokens.end());
+    EXPECT_EQ("OFFSET", it->to_str());
+    ++it;
+    EXPECT_EQ(refrange::strrange("1.0"), *it);
+    ++it;
+    EXPECT_EQ(-2.5, it->to_double());
+    ++it;
+    EXPECT_EQ(3, it->to_int());
+    ++it;
+    EXPECT_TRUE(it==tokens.end());
+
+    // empty tokens are skipped
+    std::vector<std::string> values;
+    auto csv=refrange::strrange(",a,,bc,");
+    for(auto it=csv.tokens(',').begin(); it!=csv.tokens(',').end(); ++it){
+        values.push_back(it->to_str());
+    }
+    ASSERT_EQ(2, values.size());
+    EXPECT_EQ("a", values[0]);
+    EXPECT_EQ("bc", values[1]);
+
+    // functor
+    auto digits=refrange::strrange("ab12cd345");
+    auto is_alpha=[](const unsigned char *p){ return *p>='a' && *p<='z'; };
+    auto numbers=digits.tokens(is_alpha);
+    EXPECT_EQ(2, std::distance(numbers.begin(), numbers.end()));
+
+    // same as split
+    auto splited=range.split();
+    EXPECT_EQ(4, splited.size());
+    EXPECT_TRUE(std::equal(splited.begin(), splited.end(), tokens.begin()));
+
+    EXPECT_TRUE(refrange::strrange("   ").tokens().begin()==refrange::strrange("   ").tokens().end());
 }
 
+TEST(TextTest, char_class) 
+{
+    for(int c=0; c<256; ++c){
+        unsigned char b=static_cast<unsigned char>(c);
+        EXPECT_EQ(c==' ' || (c>='\t' && c<='\r'), refrange::text::is_space(&b)) << c;
+        EXPECT_EQ(c>='0' && c<='9', refrange::text::is_digit(&b)) << c;
+        EXPECT_EQ((c>='a' && c<='z') || (c>='A' && c<='Z'), refrange::text::is_alpha(&b)) << c;
+    }
+
+    auto range=refrange::strrange("abc 123def");
+    auto digits=range.find_range_if(refrange::text::digit_class());
+    EXPECT_EQ(refrange::strrange("123"), digits);
+    auto word=range.find_range_if(refrange::text::not_class<refrange::text::space_class>(), digits.begin());
+    EXPECT_EQ(refrange::strrange("123def"), word);
+}
+
+TEST(RangeTest, find) 
+{
+    auto range=refrange::strrange("OFFSET 1 2 3 // comment // end");
+    EXPECT_EQ(range.begin()+13, range.find((const unsigned char*)"//"));
+    EXPECT_EQ(range.begin()+7, range.find_byte('1'));
+    EXPECT_EQ(range.end(), range.find_byte('x'));
+    EXPECT_EQ(range.end(), range.find((const unsigned char*)"///"));
+    EXPECT_EQ(range.begin()+24, range.find(refrange::strrange("// end")));
+
+    // comment_deleter
+    EXPECT_EQ(refrange::strrange("OFFSET 1 2 3 "), refrange::text::comment_deleter()(range));
+
+    // the vector and the scalar paths against std::search
+    std::string haystack;
+    for(int i=0; i<300; ++i){
+        haystack.push_back("ab\xff"[(i*7+i/5)%3]);
+    }
+    auto h=refrange::immutable_range((const unsigned char*)haystack.c_str(), (const unsigned char*)haystack.c_str()+haystack.size());
+    for(size_t len=1; len<40; ++len){
+        for(size_t pos=0; pos+len<=haystack.size(); pos+=37){
+            auto needle=haystack.substr(pos, len);
+            auto expected=std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end())-haystack.begin();
+            EXPECT_EQ(h.begin()+expected, h.find((const unsigned char*)needle.c_str(), needle.size())) << pos << ":" << len;
+        }
+        std::string missing(len, 'c');
+        EXPECT_EQ(h.end(), h.find((const unsigned char*)missing.c_str(), missing.size()));
+    }
+
+    // range_reader moves to the byte
+    refrange::text::text_reader reader(refrange::strrange("abc\ndef"));
+    EXPECT_EQ('\n', *reader.find('\n'));
+    EXPECT_TRUE(reader.find('x')==reader.get_range().end());
+}
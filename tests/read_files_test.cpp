@@ -0,0 +1,57 @@
+#include <refrange/read_files.h>
+#include <refrange/text/vpd.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+
+
+static std::string temp_dir()
+{
+#ifdef _WIN32
+    auto dir=getenv("TEMP");
+    return std::string(dir ? dir : ".")+"\\";
+#else
+    auto dir=getenv("TMPDIR");
+    return std::string(dir && *dir ? dir : "/tmp")+"/";
+#endif
+}
+
+
+TEST(ReadFilesTest, read_files)
+{
+    std::vector<std::string> paths;
+    std::vector<std::string> contents;
+    for(int i=0; i<100; ++i){
+        auto path=temp_dir()+"read_files_"+std::to_string(i)+".vpd";
+        std::string content="Vocaloid Pose Data file\n\nmodel.osm;\n1;\n\nBone0{center\n  0.1,"
+            +std::to_string(i)+",0.3;\n  0,0,0,1;\n}\n";
+        auto fp=fopen(path.c_str(), "wb");
+        fwrite(content.data(), 1, content.size(), fp);
+        fclose(fp);
+        paths.push_back(path);
+        contents.push_back(content);
+    }
+    paths.push_back("no/such/file");
+
+    refrange::thread_pool pool(4);
+    std::vector<float> y(paths.size(), -1);
+    std::atomic<int> matched(0);
+    auto failed=refrange::read_files(pool, paths, [&](size_t index, const refrange::immutable_range &data){
+        if(data==contents[index]){
+            ++matched;
+        }
+        refrange::text::vpd::loader l;
+        if(l.load(data)){
+            y[index]=l.get_bones()[0].translation.y;
+        }
+    });
+
+    ASSERT_EQ(1, failed.size());
+    EXPECT_EQ(100, failed[0]);
+    EXPECT_EQ(100, matched);
+    for(int i=0; i<100; ++i){
+        EXPECT_EQ(static_cast<float>(i), y[i]);
+        remove(paths[i].c_str());
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <refrange/msgpack/generated.h>
+#include <array>
+//
+// this header is generated by scripts/generate_decoder.py
+//   generate_decoder.py record '{string:int,string:[float,float,float],string:string,string:{string:bool,string:[int,string]},string:[]}' id position name flags visible tag empty
+//
+// don't modify by hand !
+//
+
+namespace refrange {
+namespace msgpack {
+
+
+struct record_flags_tag
+{
+    int item0;
+    std::string item1;
+};
+
+struct record_flags
+{
+    bool visible;
+    record_flags_tag tag;
+};
+
+struct record_empty
+{
+};
+
+struct record
+{
+    int id;
+    std::array<float, 3> position;
+    std::string name;
+    record_flags flags;
+    record_empty empty;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// record {string:int,string:[float,float,float],string:string,string:{string:bool,string:[int,string]},string:[]}
+//////////////////////////////////////////////////////////////////////////////
+inline const unsigned char *decode(const unsigned char *p, const unsigned char *end, record &t)
+{
+    using namespace generated;
+    p=read_map_head(p, end, 5);
+    p=read_key(p, end, "id", 2);
+    p=read_int(p, end, t.id);
+    p=read_key(p, end, "position", 8);
+    p=read_array_head(p, end, 3);
+    p=read_float(p, end, t.position[0]);
+    p=read_float(p, end, t.position[1]);
+    p=read_float(p, end, t.position[2]);
+    p=read_key(p, end, "name", 4);
+    p=read_str(p, end, t.name);
+    p=read_key(p, end, "flags", 5);
+    p=read_map_head(p, end, 2);
+    p=read_key(p, end, "visible", 7);
+    p=read_bool(p, end, t.flags.visible);
+    p=read_key(p, end, "tag", 3);
+    p=read_array_head(p, end, 2);
+    p=read_int(p, end, t.flags.tag.item0);
+    p=read_str(p, end, t.flags.tag.item1);
+    p=read_key(p, end, "empty", 5);
+    p=read_array_head(p, end, 0);
+    return p;
+}
+
+inline packer &encode(packer &p, const record &t)
+{
+    using namespace generated;
+    p.begin_collection(map(5));
+    {
+        static const unsigned char key[]={0xa2, 0x69, 0x64};
+        write_packed(p, key, sizeof(key));
+    }
+    p.pack_int(t.id);
+    {
+        static const unsigned char key[]={0xa8, 0x70, 0x6f, 0x73, 0x69, 0x74, 0x69, 0x6f, 0x6e};
+        write_packed(p, key, sizeof(key));
+    }
+    p.begin_collection(array(3));
+    p.pack_float(t.position[0]);
+    p.pack_float(t.position[1]);
+    p.pack_float(t.position[2]);
+    {
+        static const unsigned char key[]={0xa4, 0x6e, 0x61, 0x6d, 0x65};
+        write_packed(p, key, sizeof(key));
+    }
+    p.pack_str(t.name.c_str(), t.name.size());
+    {
+        static const unsigned char key[]={0xa5, 0x66, 0x6c, 0x61, 0x67, 0x73};
+        write_packed(p, key, sizeof(key));
+    }
+    p.begin_collection(map(2));
+    {
+        static const unsigned char key[]={0xa7, 0x76, 0x69, 0x73, 0x69, 0x62, 0x6c, 0x65};
+        write_packed(p, key, sizeof(key));
+    }
+    p.pack_bool(t.flags.visible);
+    {
+        static const unsigned char key[]={0xa3, 0x74, 0x61, 0x67};
+        write_packed(p, key, sizeof(key));
+    }
+    p.begin_collection(array(2));
+    p.pack_int(t.flags.tag.item0);
+    p.pack_str(t.flags.tag.item1.c_str(), t.flags.tag.item1.size());
+    {
+        static const unsigned char key[]={0xa5, 0x65, 0x6d, 0x70, 0x74, 0x79};
+        write_packed(p, key, sizeof(key));
+    }
+    { static const unsigned char head[]={0x90}; write_packed(p, head, 1); }
+    return p;
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,108 @@
+#include <refrange/msgpack/schema.h>
+#include <refrange/msgpack/utility.h>
+#include <gtest/gtest.h>
+#include <sstream>
+
+
+static refrange::immutable_range packed_range(refrange::msgpack::packer &p)
+{
+    return refrange::immutable_range(p.pointer(), p.pointer()+p.size());
+}
+
+static const refrange::msgpack::schema_node *find_field(
+        const refrange::msgpack::schema &s, const refrange::msgpack::schema_node &n, const std::string &name)
+{
+    for(auto it=n.fields.begin(); it!=n.fields.end(); ++it){
+        if(it->name==name){
+            return &s.node(it->node);
+        }
+    }
+    return 0;
+}
+
+
+TEST(SchemaTest, infer)
+{
+    // packing
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::map(3) << "id" << 1 << "name" << "a" << "values" << refrange::msgpack::array(2) << 1.5 << 2.5;
+    p << refrange::msgpack::map(2) << "id" << -3 << "name" << "abc";
+    p << refrange::msgpack::map(3) << "id" << 7 << "name" << 0 << "values" << refrange::msgpack::array(5) << 1 << 2 << 3 << 4 << 5;
+
+    refrange::msgpack::schema s;
+    s.add_stream(packed_range(p));
+    EXPECT_EQ(3, s.messages());
+
+    auto &root=s.root();
+    EXPECT_EQ(3, root.type_counts[refrange::msgpack::schema_map]);
+    ASSERT_EQ(3, root.fields.size());
+    EXPECT_FALSE(root.is_optional(root.fields[0]));
+    EXPECT_TRUE(root.is_optional(root.fields[2]));
+
+    auto id=find_field(s, root, "id");
+    ASSERT_TRUE(id!=0);
+    EXPECT_EQ(-3, id->min_int);
+    EXPECT_EQ(7, id->max_int);
+
+    // union
+    auto name=find_field(s, root, "name");
+    ASSERT_TRUE(name!=0);
+    EXPECT_EQ(2, name->type_counts[refrange::msgpack::schema_str]);
+    EXPECT_EQ(1, name->type_counts[refrange::msgpack::schema_int]);
+    EXPECT_EQ(1, name->min_len);
+    EXPECT_EQ(3, name->max_len);
+
+    auto values=find_field(s, root, "values");
+    ASSERT_TRUE(values!=0);
+    // 2 in [2, 4), 5 in [4, 8)
+    EXPECT_EQ(1, values->array_lengths[2]);
+    EXPECT_EQ(1, values->array_lengths[3]);
+    auto &items=s.node(values->items);
+    EXPECT_EQ(7, items.count);
+    EXPECT_EQ(2, items.type_counts[refrange::msgpack::schema_float]);
+    EXPECT_EQ(5, items.type_counts[refrange::msgpack::schema_int]);
+}
+
+TEST(SchemaTest, duplicated_key)
+{
+    auto p=refrange::msgpack::create_vector_packer();
+    p << refrange::msgpack::map(2) << "x" << 1 << "x" << 2;
+    p << refrange::msgpack::map(0);
+    p << refrange::msgpack::map(2) << "x" << 3 << "x" << 4;
+
+    refrange::msgpack::schema s;
+    s.add_stream(packed_range(p));
+
+    auto &root=s.root();
+    ASSERT_EQ(1, root.fields.size());
+    EXPECT_EQ(2, root.fields[0].count);
+    EXPECT_TRUE(root.is_optional(root.fields[0]));
+}
+
+TEST(SchemaTest, merge)
+{
+    auto a=refrange::msgpack::create_vector_packer();
+    a << refrange::msgpack::map(1) << "x" << 1;
+    auto b=refrange::msgpack::create_vector_packer();
+    b << refrange::msgpack::map(2) << "x" << 10 << "y" << "yy";
+
+    std::vector<refrange::immutable_range> inputs;
+    inputs.push_back(packed_range(a));
+    inputs.push_back(packed_range(b));
+
+    refrange::thread_pool pool(2);
+    auto s=refrange::msgpack::infer_schema(pool, inputs);
+    EXPECT_EQ(2, s.messages());
+
+    auto &root=s.root();
+    ASSERT_EQ(2, root.fields.size());
+    EXPECT_FALSE(root.is_optional(root.fields[0]));
+    EXPECT_TRUE(root.is_optional(root.fields[1]));
+    auto x=find_field(s, root, "x");
+    EXPECT_EQ(1, x->min_int);
+    EXPECT_EQ(10, x->max_int);
+
+    std::stringstream ss;
+    s.print(ss);
+    EXPECT_EQ("{\n  x:int(1..10)\n  y?:string(2..2)\n}\n", ss.str());
+}
@@ -0,0 +1,72 @@
+#include <refrange/tree.h>
+#include <gtest/gtest.h>
+
+
+TEST(TreeTest, add_child)
+{
+    refrange::node<int> child(1);
+    child.add_child(refrange::node<int>(2));
+
+    refrange::node<int> root(0);
+    auto &added=root.add_child(child);
+
+    // the copies point into the new tree
+    EXPECT_EQ(&root, added.parent);
+    EXPECT_EQ(&added, added.children.front().parent);
+    EXPECT_EQ(&added.children.front(), root.find(2));
+}
+
+TEST(TreeTest, flat_hierarchy)
+{
+    //     0
+    //   1   2
+    //  3 4
+    refrange::flat_hierarchy h;
+    h.add(refrange::flat_hierarchy::none, "root");
+    h.add(0, "a");
+    h.add(0, "b");
+    h.add(1, "a1");
+    h.add(1, "a2");
+    EXPECT_THROW(h.add(5), std::invalid_argument);
+
+    ASSERT_EQ(5, h.size());
+    EXPECT_EQ(1, h.parent(3));
+    EXPECT_EQ(1, h.first_child(0));
+    EXPECT_EQ(2, h.next_sibling(1));
+    EXPECT_EQ(4, h.next_sibling(3));
+    EXPECT_EQ(refrange::flat_hierarchy::none, h.next_sibling(4));
+    EXPECT_EQ(3, h.find("a1"));
+
+    // depth first, subtrees contiguous
+    EXPECT_TRUE(h.order().empty());
+    h.finalize();
+    std::vector<int> expected={ 0, 1, 3, 4, 2 };
+    EXPECT_EQ(expected, h.order());
+
+    // parent before child. readable through a const reference
+    const refrange::flat_hierarchy &c=h;
+    auto &order=c.order();
+    std::vector<int> position(h.size());
+    for(size_t i=0; i<order.size(); ++i){
+        position[order[i]]=static_cast<int>(i);
+    }
+    for(int i=1; i<static_cast<int>(h.size()); ++i){
+        EXPECT_LT(position[h.parent(i)], position[i]);
+    }
+}
+
+TEST(TreeTest, flat_hierarchy_add_after_finalize)
+{
+    refrange::flat_hierarchy h;
+    h.add(refrange::flat_hierarchy::none);
+    h.add(0);
+    h.finalize();
+    ASSERT_EQ(2, h.order().size());
+
+    // an add drops the order until the next finalize
+    h.add(0);
+    EXPECT_TRUE(h.order().empty());
+    h.finalize();
+    std::vector<int> expected={ 0, 1, 2 };
+    EXPECT_EQ(expected, h.order());
+}
@@ -0,0 +1,87 @@
+#include <refrange/binary/vmd.h>
+#include <gtest/gtest.h>
+#include <string.h>
+
+
+static void push(std::vector<unsigned char> &buf, const void *p, size_t size)
+{
+    buf.insert(buf.end(), (const unsigned char*)p, (const unsigned char*)p+size);
+}
+
+static void push_str(std::vector<unsigned char> &buf, const char *s, size_t size)
+{
+    std::vector<char> padded(size, 0);
+    memcpy(&padded[0], s, strlen(s));
+    push(buf, &padded[0], size);
+}
+
+static std::vector<unsigned char> create_vmd()
+{
+    std::vector<unsigned char> buf;
+    push_str(buf, "Vocaloid Motion Data 0002", 30);
+    push_str(buf, "model", 20);
+
+    unsigned int count=2;
+    push(buf, &count, 4);
+    for(unsigned int i=0; i<count; ++i){
+        push_str(buf, "center", 15);
+        unsigned int frame=10*(i+1);
+        push(buf, &frame, 4);
+        float values[7]={ 1, 2, 3, 0, 0, 0, 1 };
+        push(buf, values, sizeof(values));
+        char interpolate[64]={ static_cast<char>(i) };
+        push(buf, interpolate, 64);
+    }
+
+    count=1;
+    push(buf, &count, 4);
+    push_str(buf, "smile", 15);
+    unsigned int frame=30;
+    push(buf, &frame, 4);
+    float value=0.5f;
+    push(buf, &value, 4);
+    return buf;
+}
+
+
+TEST(VmdTest, load)
+{
+    auto buf=create_vmd();
+    refrange::binary::vmd::loader l;
+    ASSERT_TRUE(l.load(refrange::vectorrange(buf)));
+
+    EXPECT_EQ("model", l.get_modelname());
+    ASSERT_EQ(2, l.get_boneframes().size());
+    auto &f=l.get_boneframes()[1];
+    EXPECT_EQ("center", f.bonename);
+    EXPECT_EQ(20, f.framenum);
+    EXPECT_EQ(3.0f, f.pos.z);
+    EXPECT_EQ(1.0f, f.rot.w);
+    EXPECT_EQ(1, f.interpolate[0]);
+
+    ASSERT_EQ(1, l.get_morphframes().size());
+    EXPECT_EQ("smile", l.get_morphframes()[0].morphname);
+    EXPECT_EQ(0.5f, l.get_morphframes()[0].value);
+    EXPECT_EQ(30, l.get_maxframenum());
+
+    // a truncated section fails before it is decoded
+    buf.resize(buf.size()-1);
+    refrange::binary::vmd::loader truncated;
+    EXPECT_THROW(truncated.load(refrange::vectorrange(buf)), std::range_error);
+}
+
+TEST(ReaderTest, span)
+{
+    const unsigned char data[]={ 1, 0, 2, 0, 3, 0, 4 };
+    refrange::range_reader r(refrange::immutable_range(data, data+sizeof(data)));
+
+    auto values=r.read_array<unsigned short>(3);
+    ASSERT_EQ(3, values.size());
+    EXPECT_EQ(3, values[2]);
+
+    EXPECT_THROW(r.span(2), std::range_error);
+    EXPECT_THROW(r.span(static_cast<size_t>(-1), 2), std::range_error);
+    auto cursor=r.span(1);
+    EXPECT_EQ(4, cursor.read<unsigned char>());
+    EXPECT_TRUE(r.is_end());
+}